@@ -0,0 +1,141 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+/*
+ *  Per-state cost of the state manipulation in longest_path, on random
+ *  states of a given width with labels scattered over the whole int8_t
+ *  range (as they are before canonicalization).
+ *
+ *  usage: bench_states [width [num_states]]
+ */
+
+#include "../src/longest_path.hpp"
+#include "../src/utility/polynomial.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+typedef longest_path<polynomial<long> > algo;
+typedef algo::connectivity connectivity;
+
+// a random state: pairs of strand ends, bullets, empty vertices and at
+// most two single ends, with distinct labels in [1, 127]
+connectivity random_state(std::size_t width, std::mt19937& rng)
+{
+  std::vector<int8_t> labels;
+  for (int8_t x = 1; x > 0; ++x)
+    labels.push_back(x);
+  std::shuffle(labels.begin(), labels.end(), rng);
+
+  connectivity c(width, 0);
+  std::size_t next = 0, singles = 0;
+  for (std::size_t i = 0; i < width; ++i) {
+    if (c[i] != 0)
+      continue;
+    switch (rng() % 4) {
+      case 0:
+        break;
+      case 1:
+        c[i] = -1;
+        break;
+      default:
+        // pair i with a later empty vertex, if there is one
+        std::size_t j = i + 1 + rng() % (width - i);
+        while (j < width and c[j] != 0)
+          ++ j;
+        if (j < width) {
+          c[i] = c[j] = labels[next++];
+        } else if (singles < 2) {
+          c[i] = labels[next++];
+          ++ singles;
+        }
+    }
+    if (next == labels.size())
+      break;
+  }
+  return c;
+}
+
+// the labels of c are 1, 2, .. in order of first appearance
+bool is_canonical(connectivity const& c)
+{
+  int8_t k = 0;
+  for (auto x : c) {
+    if (x > k + 1)
+      return false;
+    if (x == k + 1)
+      ++ k;
+  }
+  return true;
+}
+
+template<class F>
+void measure(const char* name, std::size_t n, F f)
+{
+  typedef std::chrono::steady_clock clock;
+  auto start = clock::now();
+  f();
+  auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start);
+  std::cout << name << ": " << elapsed.count() / n << " ns/state\n";
+}
+
+int main(int argc, char* argv[])
+{
+  std::size_t width = argc > 1 ? std::atoi(argv[1]) : 64;
+  std::size_t num_states = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+  std::mt19937 rng(42);
+  std::vector<connectivity> states;
+  for (std::size_t i = 0; i < num_states; ++i)
+    states.push_back(random_state(width, rng));
+
+  for (auto const& c : states) {
+    auto d = algo::canonicalize(c);
+    if (not is_canonical(d) or algo::how_many_endpoints(d) != algo::how_many_endpoints(c)) {
+      std::cerr << "error: canonicalize gave a wrong result\n";
+      return 1;
+    }
+  }
+
+  // keeps the results alive
+  std::size_t check = 0;
+  measure("canonicalize", num_states, [&]() {
+    for (auto const& c : states)
+      check += algo::canonicalize(c)[0];
+  });
+
+  measure("how_many_endpoints", num_states, [&]() {
+    for (auto const& c : states)
+      check += algo::how_many_endpoints(c);
+  });
+
+  algo::table_type table;
+  for (auto const& c : states)
+    table[algo::canonicalize(c)] += polynomial<long>(1);
+  algo op;
+  measure("join_operator", table.size(), [&]() {
+    check += op.join_operator(0, width - 1, table).size();
+  });
+
+  std::cerr << check << "\n";
+  return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ *  Many graphs in one process. The jobs come either from a directory, one
+ *  graph per file in any input format, or from a stream with one graph per
+ *  line in the edges format, optionally preceded by an id and a tab. Blank
+ *  lines and lines starting with '#' are skipped. The graphs are solved on
+ *  a pool of threads, each keeping its own allocation pools warm from one
+ *  graph to the next, and every result is written as a line of JSON in the
+ *  order of the input.
+ */
+
+namespace batch {
+
+  struct job {
+    std::string id;
+    // the graph itself, or the name of the file holding it
+    std::string text;
+    bool is_file;
+  };
+
+  class source {
+    std::mutex mutex_;
+    std::istream* in_;
+    std::vector<std::string> files_;
+    std::string directory_;
+    std::size_t next_;
+    unsigned int line_;
+    std::ifstream file_;
+
+  public:
+    // a directory, a file or "-" for stdin
+    explicit source(std::string const& name)
+      : in_(nullptr), next_(0), line_(0)
+    {
+      struct stat st;
+      if (name != "-" and stat(name.c_str(), &st) == 0 and S_ISDIR(st.st_mode)) {
+        directory_ = name;
+        DIR* dir = opendir(name.c_str());
+        if (dir == nullptr)
+          throw std::runtime_error("cannot read directory " + name);
+        while (dirent* entry = readdir(dir)) {
+          std::string path = name + "/" + entry->d_name;
+          if (stat(path.c_str(), &st) == 0 and S_ISREG(st.st_mode))
+            files_.push_back(entry->d_name);
+        }
+        closedir(dir);
+        std::sort(files_.begin(), files_.end());
+      } else if (name == "-") {
+        in_ = &std::cin;
+      } else {
+        file_.open(name);
+        if (not file_.is_open())
+          throw std::runtime_error("cannot read " + name);
+        in_ = &file_;
+      }
+    }
+
+    // the next job and its position in the input, false at the end
+    bool next(job& j, std::size_t& position)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (in_ == nullptr) {
+        if (next_ == files_.size())
+          return false;
+        j.id = files_[next_];
+        j.text = directory_ + "/" + files_[next_];
+        j.is_file = true;
+        position = next_++;
+        return true;
+      }
+      std::string line;
+      while (std::getline(*in_, line)) {
+        ++ line_;
+        if (line.empty() or line[0] == '#')
+          continue;
+        auto tab = line.find('\t');
+        if (tab == std::string::npos) {
+          j.id = std::to_string(line_);
+          j.text = line;
+        } else {
+          j.id = line.substr(0, tab);
+          j.text = line.substr(tab + 1);
+        }
+        j.is_file = false;
+        position = next_++;
+        return true;
+      }
+      return false;
+    }
+  };
+
+  // writes the lines in order of position, as soon as all the previous
+  // ones are written
+  class ordered_output {
+    std::mutex mutex_;
+    std::ostream& out_;
+    std::map<std::size_t, std::string> pending_;
+    std::size_t next_;
+
+  public:
+    explicit ordered_output(std::ostream& out) : out_(out), next_(0) { }
+
+    void write(std::size_t position, std::string const& line)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_[position] = line;
+      for (auto i = pending_.begin(); i != pending_.end() and i->first == next_;
+           i = pending_.erase(i), ++ next_)
+        out_ << i->second << "\n";
+      out_.flush();
+    }
+  };
+
+  inline std::string json_string(std::string const& s)
+  {
+    std::string r = "\"";
+    for (char c : s) {
+      switch (c) {
+        case '"':  r += "\\\""; break;
+        case '\\': r += "\\\\"; break;
+        case '\n': r += "\\n"; break;
+        case '\t': r += "\\t"; break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\u%04x", c);
+            r += buf;
+          } else {
+            r += c;
+          }
+      }
+    }
+    return r + "\"";
+  }
+
+  /*
+   *  Runs solve(job) on every job of the source with the given number of
+   *  threads. solve returns the fields of the JSON object after the id, a
+   *  job throwing an exception gives an "error" field instead.
+   */
+  template<class Solve>
+  void run(source& jobs, unsigned int num_threads, Solve solve, std::ostream& out)
+  {
+    ordered_output output(out);
+    auto worker = [&]() {
+      job j;
+      std::size_t position;
+      while (jobs.next(j, position)) {
+        std::ostringstream line;
+        line << "{\"id\": " << json_string(j.id);
+        try {
+          auto fields = solve(j);
+          line << ", " << fields;
+        } catch (std::exception& e) {
+          line << ", \"error\": " << json_string(e.what());
+        }
+        line << "}";
+        output.write(position, line.str());
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < num_threads; ++i)
+      threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+      t.join();
+  }
+}
+
+#endif
@@ -19,13 +19,15 @@
 #ifndef CHINESE_REMAINDER_HPP
 
 #include "transfer.hpp"
-#include "tree_decomposition/tree_decomposition.hpp"
+#include "tree_decomposition/flat_tree.hpp"
 #include "utility/gmp.hpp"
 #include "utility/polynomial.hpp"
 #include "utility/Zp.hpp"
 
-#include <numeric>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 namespace chinese_remainder {
   const uint32_t primes[] = {
@@ -40,47 +42,78 @@ namespace chinese_remainder {
 
   using gmp::mpz_int;
 
-  using tree_decomposition::bag_ptr;
-
+  using tree_decomposition::flat_tree;
+
+  /*
+   *  Garner's reconstruction: the result x is known modulo M, the product
+   *  of the primes so far, in the symmetric range (-M/2, M/2]. A new
+   *  residue r modulo p gives
+   *
+   *    x' = x + M ((r - x) M^-1 mod p)
+   *
+   *  which is O(1) big integer operations per coefficient, whatever the
+   *  number of primes. A coefficient is unchanged when the correction is
+   *  zero, and it is exact once M is more than twice its bound, if one is
+   *  known. The transfer stops when every coefficient is exact or when a
+   *  new prime changes none of them.
+   *
+   *  bound[i], if given, bounds the absolute value of the coefficient of
+   *  x^i.
+   */
   template<template<class> class Algorithm, class... Args>
-  void chinese_remainder(bag_ptr t, Args&&... args)
+  typename Algorithm<mpz_int>::weight_type
+  chinese_remainder(flat_tree const& t, std::vector<mpz_int> const& bound,
+                    Args&&... args)
   {
     using modular::Zp;
     using big_t = typename Algorithm<mpz_int>::weight_type;
 
-    unsigned int k = 0;
-    big_t partial_results[num_primes];
-    big_t result_last, result;
-    mpz_int qs[num_primes];
-    mpz_int pp = 1;
-
-    do {
-      Zp::set_modulus(primes[k]);
-      Algorithm<Zp> algo(std::forward<Args>(args)...);
-
-      pp *= primes[k];
+    big_t result;
+    mpz_int M = 1;
 
-      for (unsigned int i = 0; i < k + 1; ++ i)
-        qs[i] = pp / primes[i] * modinv(pp / primes[i], primes[i]);
+    for (unsigned int k = 0; ; ++ k) {
+      if (k == num_primes)
+        throw std::runtime_error("chinese remainder: out of primes");
 
-      result_last = result;
-
-      partial_results[k] = big_t(transfer::transfer(algo, t));
-      std::cerr << "result (mod " << Zp::get_modulus() << ")\t: " << partial_results[k] << "\n";
+      uint64_t const p = primes[k];
+      Zp::set_modulus(p);
+      Algorithm<Zp> algo(std::forward<Args>(args)...);
 
-      result = std::inner_product(partial_results, partial_results + k + 1, qs, big_t(0));
+      auto residue = transfer::transfer(algo, t);
+      std::cerr << "result (mod " << p << ")\t: " << residue << "\n";
 
       // this is specific to polynomial
-      mpz_int limit = pp >> 1;
-      for (auto& c : result) {
-        c %= pp;
-        if (c > limit)
-          c -= pp;
+      if (result.order() < residue.order())
+        result.order(residue.order());
+
+      uint64_t const inverse = static_cast<unsigned long>(modinv(M % p, p));
+      mpz_int const new_M = M * p;
+      mpz_int const limit = new_M >> 1;
+
+      std::size_t changed = 0, exact = 0;
+      for (std::size_t i = 0; i <= result.order(); ++ i) {
+        auto& x = result[i];
+        uint64_t const r = i <= residue.order() ? static_cast<unsigned long>(residue[i]) : 0;
+        uint64_t const xp = static_cast<unsigned long>(x % p);
+        uint64_t const c = modular::mul_mod(r >= xp ? r - xp : p - (xp - r), inverse, p);
+        if (c != 0) {
+          addmul(x, M, mpz_int(c));
+          if (x > limit)
+            x -= new_M;
+          ++ changed;
+        }
+        if (i < bound.size() and new_M > bound[i] + bound[i])
+          ++ exact;
       }
+      M = new_M;
+
+      std::cerr << "modulus has " << k + 1 << " primes, " << changed
+                << " coefficients changed, " << exact << " exact\n";
 
-      ++ k;
-    } while (result != result_last);
-    std::cout << result << "\n";
+      if (exact == result.order() + 1 or (k > 0 and changed == 0))
+        break;
+    }
+    return result;
   }
 }
 #endif
@@ -0,0 +1,108 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef CONNECTIVITY_HPP
+#define CONNECTIVITY_HPP
+
+#include "utility/small_vector.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ *  States shared by the operator sets built on strands (longest_path,
+ *  cycles): one entry per vertex of the bag, 0 for an unused vertex, -1
+ *  for a vertex inside a strand (a bullet) and a positive label for a
+ *  strand end, the two ends of a strand having the same label. The
+ *  empty vector marks a finished state.
+ *
+ *  A state of up to 31 entries is kept inline in 32 bytes: the bags hardly
+ *  ever have more than a dozen vertices, and making, copying or dropping a
+ *  state then never allocates. Wider bags have their states on the heap.
+ */
+
+struct connectivity_states
+{
+  using connectivity = small_vector<int8_t, 31>;
+
+  // labels are positive int8_t, a table indexed by label covers them all
+  static const std::size_t max_labels = 128;
+
+  static connectivity canonicalize(connectivity c)
+  {
+    // only the entries of the labels seen so far are initialised
+    std::bitset<max_labels> seen;
+    int8_t table[max_labels];
+
+    // starts recounting from 1
+    int8_t k = 1;
+    for (auto& x : c) {
+      if (x <= 0)
+        continue;
+      if (not seen[x]) {
+        seen.set(x);
+        table[x] = k++;
+      }
+      x = table[x];
+    }
+    return c;
+  }
+
+  // the number of strands with a single end in c: each end flips the
+  // bit of its label, what is left set are the labels seen once
+  static std::size_t how_many_endpoints(connectivity const& c)
+  {
+    std::bitset<max_labels> odd;
+    for (auto x : c) {
+      if (x > 0)
+        odd.flip(x);
+    }
+    return odd.count();
+  }
+
+  // the state with the vertex at position i moved to position p[i]
+  template<class Permutation>
+  static connectivity permute(connectivity const& c, Permutation const& p)
+  {
+    if (is_finished(c))
+      return c;
+    connectivity newc(c.size());
+    for (std::size_t i = 0; i < c.size(); ++i)
+      newc[p[i]] = c[i];
+    return canonicalize(newc);
+  }
+
+  static bool is_empty(connectivity const& c)
+  {
+    if (c.empty())
+      return false;
+    for (auto x : c) {
+      if (x != 0)
+        return false;
+    }
+    return true;
+  }
+
+  static bool is_finished(connectivity const& c)
+  {
+    return c.empty();
+  }
+};
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef CYCLES_HPP
+#define CYCLES_HPP
+
+#include "connectivity.hpp"
+#include "profile.hpp"
+#include "representative.hpp"
+#include "tables.hpp"
+#include "utility/addmul.hpp"
+
+#include "boost/optional.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/*
+ *  Operators counting the cycles (self-avoiding polygons) of a graph by
+ *  number of edges, the constant term counting the empty subgraph. The
+ *  states are those of longest_path, except that every strand has both
+ *  ends in the bag: a strand end with no edges left can never be closed.
+ *  The finished state is a single closed cycle. Table is hash_table or
+ *  sorted_table, see tables.hpp.
+ */
+
+template<class Weight, template<class, class> class Table = hash_table>
+struct cycles : connectivity_states
+{
+  using weight_type = Weight;
+  using state_type = connectivity;
+  using table_type = Table<connectivity, weight_type>;
+
+  // whether the transfer should drop dead states, see prune_operator, and
+  // keep only a representative set of the others, see reduce_operator
+  bool prune;
+  bool reduce;
+
+  explicit cycles(bool prune = false, bool reduce = false)
+    : prune(prune), reduce(reduce) { }
+
+  static boost::optional<connectivity>
+  connect(connectivity c, std::size_t i, std::size_t j)
+  {
+    // don't touch a finished state
+    if (is_finished(c))
+      return {};
+
+    auto li = c[i], lj = c[j];
+
+    // check we are not hitting bullets
+    if (li < 0 or lj < 0)
+      return {};
+
+    // a new strand
+    if (li == 0 and lj == 0) {
+      c[i] = c[j] = *std::max_element(c.begin(), c.end()) + 1;
+      return c;
+    }
+
+    // extending a strand
+    if (lj == 0) {
+      c[i] = -1; c[j] = li;
+      return c;
+    }
+    if (li == 0) {
+      c[i] = lj; c[j] = -1;
+      return c;
+    }
+
+    // closing a strand, only if it is the only one
+    if (li == lj) {
+      for (auto x : c) {
+        if (x > 0 and x != li)
+          return {};
+      }
+      return connectivity();
+    }
+
+    // joining two strands
+    std::replace(c.begin(), c.end(), lj, li);
+    c[i] = c[j] = -1;
+    return c;
+  }
+
+  static table_type empty_state(std::size_t size)
+  {
+    return table_type{ { connectivity(size), weight_type(1) } };
+  }
+
+  // the result, once every vertex has been deleted
+  static weight_type finish(table_type const& table)
+  {
+    assert(table.size() == 1);
+    return table.begin()->second;
+  }
+
+  // the edge is of class c, see mul_var
+  table_type
+  join_operator(std::size_t i, std::size_t j, table_type const& table,
+                unsigned int c = 0) const
+  {
+    table_type new_table{table};
+    for (auto const& state : table) {
+      if (auto maybe_newc = connect(state.first, i, j))
+        new_table[canonicalize(*maybe_newc)] += mul_var(state.second, c);
+    }
+    return new_table;
+  }
+
+  table_type
+  delete_operator(std::size_t i, table_type const& table) const
+  {
+    table_type new_table;
+    for (auto const& state : table) {
+      auto const& c = state.first;
+      if (is_finished(c)) {
+        new_table[c] += state.second;
+      } else if (c[i] <= 0) {
+        // a strand end cannot be deleted
+        connectivity newc{c};
+        newc.erase(newc.begin() + i);
+        new_table[canonicalize(newc)] += state.second;
+      }
+    }
+    return new_table;
+  }
+
+  // a state is dead if a strand ends on a vertex with no edges left
+  template<class Mask>
+  table_type
+  prune_operator(Mask const& exhausted, table_type table) const
+  {
+    drop_if(table, [&](typename table_type::value_type const& state) {
+      auto const& c = state.first;
+      bool dead = false;
+      for (std::size_t k = 0; k < c.size() and not dead; ++k)
+        dead = c[k] > 0 and exhausted[k];
+      return dead;
+    });
+    return table;
+  }
+
+  // only max-plus weights can be reduced, see representative.hpp
+  table_type reduce_operator(table_type const& table) const
+  {
+    return representative::reduce(table);
+  }
+
+  template<class Mapping>
+  table_type
+  table_fusion(Mapping A_to_B, table_type const& A_table, table_type const& B_table) const
+  {
+    profile::null_counter counter;
+    return table_fusion(A_to_B, A_table, B_table, counter);
+  }
+
+  // the counter is told about every pair of states examined and accepted
+  template<class Mapping, class Counter>
+  table_type
+  table_fusion(Mapping A_to_B, table_type const& A_table,
+               table_type const& B_table, Counter& counter) const
+  {
+    table_type new_table;
+    for (auto const& stateA : A_table) {
+      // stateA in the order of B, the same for every state of B of a size
+      connectivity newa;
+      for (auto const& stateB : B_table) {
+        counter.examined();
+
+        // a finished state only goes with an empty one
+        if (is_finished(stateA.first) or is_finished(stateB.first)) {
+          if (is_empty(stateA.first) or is_empty(stateB.first)) {
+            counter.accepted();
+            addmul(new_table[connectivity()], stateA.second, stateB.second);
+          }
+          continue;
+        }
+
+        // n is the size of the destination (stateB)
+        auto const n = stateB.first.size();
+
+        // convert to the new order
+        if (newa.size() != n) {
+          newa = connectivity(n);
+          for (std::size_t i = 0; i < stateA.first.size(); ++i)
+            newa[A_to_B[i]] = stateA.first[i];
+        }
+
+        connectivity newc(stateB.first);
+
+        // the bullets of A first, they must be unused in B
+        bool valid = true;
+        for (std::size_t i = 0; i < n and valid; ++i) {
+          if (newa[i] == -1) {
+            valid = newc[i] == 0;
+            newc[i] = -1;
+          }
+        }
+
+        // then each strand of A, as an edge between its ends, newc is
+        // only used if still valid
+        std::bitset<max_labels> open;
+        std::size_t table[max_labels];
+        for (std::size_t i = 0; i < n and valid; ++i) {
+          auto const x = newa[i];
+          if (x <= 0)
+            continue;
+          if (not open[x]) {
+            open.set(x);
+            table[x] = i;
+          } else if (auto maybe_newc = connect(std::move(newc), table[x], i)) {
+            newc = std::move(*maybe_newc);
+          } else {
+            valid = false;
+          }
+        }
+
+        if (valid) {
+          counter.accepted();
+          addmul(new_table[canonicalize(newc)], stateA.second, stateB.second);
+        }
+      }
+    }
+    return new_table;
+  }
+};
+
+#endif
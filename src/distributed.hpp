@@ -0,0 +1,675 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include "connectivity.hpp"
+#include "operators.hpp"
+#include "profile.hpp"
+#include "tables.hpp"
+#include "tree_decomposition/flat_tree.hpp"
+#include "utility/fixed_uint.hpp"
+#include "utility/gmp.hpp"
+#include "utility/mpolynomial.hpp"
+#include "utility/polynomial.hpp"
+#include "utility/semiring.hpp"
+
+#include "boost/functional/hash.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ *  The transfer split among P processes on one machine. Every table is
+ *  partitioned by a hash of the states, each process (a rank) holding the
+ *  states it owns. Each operator runs on the local part, then the states
+ *  it made that belong elsewhere go to their owners in an all-to-all
+ *  exchange, where they are added to the states already there. A fusion
+ *  has no key to partition the pairs of states on (whether two states go
+ *  together depends on all of their positions), so the smaller of the two
+ *  tables is gathered whole by every rank and fused with the local part of
+ *  the other one.
+ *
+ *  Rank 0 is the calling process, the others are forked from it and talk
+ *  to each other over Unix domain sockets. Every exchange also carries
+ *  whether an operator failed on the sending rank: a fixed width integer
+ *  overflow makes every rank throw fixed::overflow, so the caller can
+ *  start again with wider integers, anything else throws a runtime_error.
+ */
+
+namespace distributed {
+  using tree_decomposition::flat_tree;
+
+  /*
+   *  The states and the weights in bytes
+   */
+
+  inline void put_bytes(std::string& out, void const* p, std::size_t n)
+  {
+    out.append(static_cast<char const*>(p), n);
+  }
+
+  class reader {
+    std::string const& in_;
+    std::size_t pos_;
+
+  public:
+    explicit reader(std::string const& in) : in_(in), pos_(0) { }
+
+    bool done() const { return pos_ == in_.size(); }
+
+    char const* take(std::size_t n)
+    {
+      if (pos_ + n > in_.size())
+        throw std::runtime_error("truncated message between processes");
+      auto p = in_.data() + pos_;
+      pos_ += n;
+      return p;
+    }
+
+    template<class T>
+    T take()
+    {
+      T x;
+      std::memcpy(&x, take(sizeof x), sizeof x);
+      return x;
+    }
+  };
+
+  using connectivity = connectivity_states::connectivity;
+
+  // a state is no wider than its bag, flat_tree::widest_bag
+  inline void put(std::string& out, connectivity const& c)
+  {
+    static_assert(tree_decomposition::flat_tree::widest_bag <= UINT8_MAX,
+                  "the size of a state is sent as a byte");
+    uint8_t n = c.size();
+    put_bytes(out, &n, 1);
+    put_bytes(out, c.data(), n);
+  }
+
+  inline void get(reader& in, connectivity& c)
+  {
+    auto n = in.take<uint8_t>();
+    auto p = in.take(n);
+    c.assign(p, p + n);
+  }
+
+  template<unsigned int N>
+  void put(std::string& out, fixed::fixed_uint<N> const& x)
+  {
+    static_assert(std::is_trivially_copyable<fixed::fixed_uint<N> >::value,
+                  "fixed_uint is sent as it is in memory");
+    put_bytes(out, &x, sizeof x);
+  }
+
+  template<unsigned int N>
+  void get(reader& in, fixed::fixed_uint<N>& x)
+  {
+    std::memcpy(&x, in.take(sizeof x), sizeof x);
+  }
+
+  inline void put(std::string& out, max_plus const& x)
+  {
+    put_bytes(out, &x, sizeof x);
+  }
+
+  inline void get(reader& in, max_plus& x)
+  {
+    std::memcpy(&x, in.take(sizeof x), sizeof x);
+  }
+
+  inline void put(std::string& out, boolean const& x)
+  {
+    uint8_t b = bool(x);
+    put_bytes(out, &b, 1);
+  }
+
+  inline void get(reader& in, boolean& x)
+  {
+    x = boolean(in.take<uint8_t>());
+  }
+
+  inline void put(std::string& out, gmp::mpz_int const& x)
+  {
+    auto const s = x.bytes();
+    uint32_t n = s.size();
+    put_bytes(out, &n, sizeof n);
+    out += s;
+  }
+
+  inline void get(reader& in, gmp::mpz_int& x)
+  {
+    auto n = in.take<uint32_t>();
+    x = gmp::mpz_int::from_bytes(in.take(n), n);
+  }
+
+  template<class T>
+  void put(std::string& out, polynomial<T> const& p)
+  {
+    uint32_t n = p.order() + 1;
+    put_bytes(out, &n, sizeof n);
+    for (auto const& c : p)
+      put(out, c);
+  }
+
+  template<class T>
+  void get(reader& in, polynomial<T>& p)
+  {
+    auto n = in.take<uint32_t>();
+    p.order(n - 1);
+    for (uint32_t i = 0; i < n; ++i)
+      get(in, p[i]);
+  }
+
+  template<class T>
+  void put(std::string& out, mpolynomial<T> const& p)
+  {
+    uint32_t n = std::distance(p.begin(), p.end());
+    put_bytes(out, &n, sizeof n);
+    for (auto const& t : p) {
+      put_bytes(out, &t.first, sizeof t.first);
+      put(out, t.second);
+    }
+  }
+
+  template<class T>
+  void get(reader& in, mpolynomial<T>& p)
+  {
+    auto n = in.take<uint32_t>();
+    std::vector<typename mpolynomial<T>::term> terms(n);
+    for (auto& t : terms) {
+      t.first = in.take<typename mpolynomial<T>::monomial>();
+      get(in, t.second);
+    }
+    p = mpolynomial<T>(std::move(terms));
+  }
+
+  /*
+   *  The sockets of a rank to all the others
+   */
+
+  class network {
+  public:
+    // what went wrong on a rank since the last exchange
+    enum failure : uint8_t { none, overflow, error };
+
+    network(unsigned int rank, std::vector<int> const& peers)
+      : rank_(rank), peers_(peers)
+    {
+      for (auto fd : peers_) {
+        if (fd >= 0)
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      }
+    }
+
+    ~network() { close(); }
+
+    void close()
+    {
+      for (auto& fd : peers_) {
+        if (fd >= 0)
+          ::close(fd);
+        fd = -1;
+      }
+    }
+
+    unsigned int rank() const { return rank_; }
+    unsigned int size() const { return peers_.size(); }
+
+    // sends out[k] to each rank k, returns what each rank sent here
+    std::vector<std::string>
+    exchange(std::vector<std::string> const& out, failure f)
+    {
+      std::vector<std::string const*> p;
+      for (auto const& s : out)
+        p.push_back(&s);
+      return run(p, f);
+    }
+
+    // sends the same message to every rank
+    std::vector<std::string> all_gather(std::string const& out, failure f)
+    {
+      return run(std::vector<std::string const*>(size(), &out), f);
+    }
+
+  private:
+    struct channel {
+      // the header going out, the one coming in and the content coming in
+      std::string out_header, in_header, in;
+      std::size_t sent, received;
+    };
+
+    std::vector<std::string> run(std::vector<std::string const*> const& out, failure f)
+    {
+      auto const n = size();
+      std::vector<channel> ch(n);
+      for (unsigned int k = 0; k < n; ++k) {
+        if (k == rank_)
+          continue;
+        uint64_t length = out[k]->size();
+        put_bytes(ch[k].out_header, &length, sizeof length);
+        ch[k].out_header += char(f);
+        ch[k].sent = ch[k].received = 0;
+      }
+
+      // a message is its header (length and failure) then its content
+      std::size_t const header_size = sizeof(uint64_t) + 1;
+      auto to_send = [&](unsigned int k) {
+        return header_size + out[k]->size() - ch[k].sent;
+      };
+      auto to_receive = [&](unsigned int k) {
+        if (ch[k].received < header_size)
+          return header_size - ch[k].received;
+        uint64_t length;
+        std::memcpy(&length, ch[k].in_header.data(), sizeof length);
+        return header_size + length - ch[k].received;
+      };
+
+      for (;;) {
+        std::vector<pollfd> fds;
+        std::vector<unsigned int> who;
+        for (unsigned int k = 0; k < n; ++k) {
+          if (k == rank_)
+            continue;
+          short events = 0;
+          if (to_send(k) > 0)
+            events |= POLLOUT;
+          if (to_receive(k) > 0)
+            events |= POLLIN;
+          if (events) {
+            fds.push_back(pollfd{ peers_[k], events, 0 });
+            who.push_back(k);
+          }
+        }
+        if (fds.empty())
+          break;
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+          if (errno == EINTR)
+            continue;
+          throw std::runtime_error("poll failed");
+        }
+
+        for (std::size_t x = 0; x < fds.size(); ++x) {
+          auto const k = who[x];
+          auto& c = ch[k];
+          if ((fds[x].revents & POLLOUT) and to_send(k) > 0) {
+            char const* p;
+            std::size_t len;
+            if (c.sent < header_size) {
+              p = c.out_header.data() + c.sent;
+              len = header_size - c.sent;
+            } else {
+              p = out[k]->data() + (c.sent - header_size);
+              len = out[k]->size() - (c.sent - header_size);
+            }
+            auto r = ::send(peers_[k], p, len, MSG_NOSIGNAL);
+            if (r < 0 and errno != EAGAIN and errno != EINTR)
+              throw std::runtime_error("a worker process has gone away");
+            if (r > 0)
+              c.sent += r;
+          }
+          if ((fds[x].revents & (POLLIN | POLLHUP | POLLERR)) and to_receive(k) > 0) {
+            char buffer[1 << 16];
+            auto len = std::min<std::size_t>(to_receive(k), sizeof buffer);
+            auto r = ::read(peers_[k], buffer, len);
+            if (r == 0 or (r < 0 and errno != EAGAIN and errno != EINTR))
+              throw std::runtime_error("a worker process has gone away");
+            if (r < 0)
+              continue;
+            std::size_t i = 0;
+            if (c.received < header_size) {
+              i = std::min<std::size_t>(r, header_size - c.received);
+              c.in_header.append(buffer, i);
+              if (c.in_header.size() == header_size) {
+                uint64_t length;
+                std::memcpy(&length, c.in_header.data(), sizeof length);
+                c.in.reserve(length);
+              }
+            }
+            c.in.append(buffer + i, r - i);
+            c.received += r;
+          }
+        }
+      }
+
+      auto worst = f;
+      std::vector<std::string> in(n);
+      for (unsigned int k = 0; k < n; ++k) {
+        if (k == rank_)
+          continue;
+        worst = std::max(worst, failure(ch[k].in_header.back()));
+        in[k].swap(ch[k].in);
+      }
+      if (worst == overflow)
+        throw fixed::overflow();
+      if (worst == error)
+        throw std::runtime_error("the transfer failed in a worker process");
+      return in;
+    }
+
+    unsigned int rank_;
+    std::vector<int> peers_;
+  };
+
+  /*
+   *  The transfer as seen by one rank, following transfer::recurse
+   */
+
+  template<class Operators>
+  class worker {
+    using table_type = typename Operators::table_type;
+    using state_type = typename Operators::state_type;
+    using weight_type = typename Operators::weight_type;
+    using value_type = typename table_type::value_type;
+
+    Operators const& op_;
+    flat_tree const& t_;
+    network& net_;
+    network::failure failed_;
+
+  public:
+    worker(Operators const& op, flat_tree const& t, network& net)
+      : op_(op), t_(t), net_(net), failed_(network::none)
+    {
+    }
+
+    // the result on rank 0, a zero weight on the others
+    weight_type run()
+    {
+      std::vector<std::pair<unsigned int, table_type> > stack;
+
+      for (unsigned int b = 0; b < t_.size(); ++b) {
+        auto table = op_.empty_state(t_.bag_size(b));
+        drop_if(table, [&](value_type const& s) { return owner(s.first) != net_.rank(); });
+
+        auto const first_child = stack.size() - t_[b].num_children;
+        for (auto k = first_child; k < stack.size(); ++k) {
+          auto const b_sib = stack[k].first;
+          auto table_sib = std::move(stack[k].second);
+
+          std::vector<unsigned int> b_sib_left_over;
+          for (auto v : t_.vertices(b_sib)) {
+            if (t_.has(b, v)) {
+              b_sib_left_over.push_back(v);
+            } else {
+              auto const i = b_sib_left_over.size();
+              local([&] { table_sib = op_.delete_operator(i, table_sib); });
+              redistribute(table_sib);
+            }
+          }
+
+          auto const A_size = b_sib_left_over.size();
+          std::vector<unsigned int> A_to_B(A_size);
+          for (unsigned int i = 0; i < A_size; ++i)
+            A_to_B[i] = t_.index(b, b_sib_left_over[i]);
+
+          table = fusion(A_to_B, table_sib, table);
+          reduce(table);
+        }
+        stack.erase(stack.begin() + first_child, stack.end());
+
+        for (auto k = t_[b].edge_begin; k < t_[b].edge_end; ++k) {
+          auto const& e = t_.edge(k);
+          local([&] {
+            table = op_.join_operator(t_.index(b, e.first), t_.index(b, e.second),
+                                      table, t_.edge_class(k));
+          });
+          redistribute(table);
+        }
+        reduce(table);
+
+        // dropping states stays local
+        if (op_.prune)
+          local([&] { table = op_.prune_operator(t_.exhausted(b), std::move(table)); });
+        stack.push_back(std::make_pair(b, std::move(table)));
+      }
+
+      auto table = std::move(stack.back().second);
+      for (auto n = t_.bag_size(t_.root()); n > 0; --n) {
+        local([&] { table = op_.delete_operator(0, table); });
+        redistribute(table);
+      }
+
+      // everything to rank 0
+      std::vector<std::string> out(net_.size());
+      if (net_.rank() != 0)
+        out[0] = serialize(table);
+      auto in = net_.exchange(out, failed_);
+      if (net_.rank() != 0)
+        return weight_type();
+      for (auto const& s : in)
+        add(table, s);
+      return op_.finish(table);
+    }
+
+  private:
+    unsigned int owner(state_type const& c) const
+    {
+      // mixed, so as not to follow the buckets of the hash tables
+      uint64_t h = boost::hash_range(c.begin(), c.end());
+      return ((h * 0x9E3779B97F4A7C15ull) >> 32) % net_.size();
+    }
+
+    // runs f unless something already failed, and remembers if it fails
+    template<class F>
+    void local(F f)
+    {
+      if (failed_ != network::none)
+        return;
+      try {
+        f();
+      } catch (fixed::overflow const&) {
+        failed_ = network::overflow;
+      } catch (std::exception const& e) {
+        std::cerr << "error on rank " << net_.rank() << ": " << e.what() << "\n";
+        failed_ = network::error;
+      }
+    }
+
+    std::string serialize(table_type const& table) const
+    {
+      std::string out;
+      for (auto const& s : table) {
+        put(out, s.first);
+        put(out, s.second);
+      }
+      return out;
+    }
+
+    void add(table_type& table, std::string const& in) const
+    {
+      reader r(in);
+      state_type c;
+      weight_type w;
+      while (not r.done()) {
+        get(r, c);
+        get(r, w);
+        table[c] += std::move(w);
+      }
+    }
+
+    // a representative set of each part is one of the whole table
+    void reduce(table_type& table)
+    {
+      if (op_.reduce)
+        local([&] { table = op_.reduce_operator(table); });
+    }
+
+    // sends the states of table owned by other ranks to them, and adds
+    // those they send here
+    void redistribute(table_type& table)
+    {
+      std::vector<std::string> out(net_.size());
+      local([&] {
+        drop_if(table, [&](value_type const& s) {
+          auto const k = owner(s.first);
+          if (k == net_.rank())
+            return false;
+          put(out[k], s.first);
+          put(out[k], s.second);
+          return true;
+        });
+      });
+      auto in = net_.exchange(out, failed_);
+      local([&] {
+        for (auto const& s : in)
+          add(table, s);
+      });
+    }
+
+    table_type gather(table_type const& table)
+    {
+      auto in = net_.all_gather(serialize(table), failed_);
+      table_type whole(table);
+      local([&] {
+        for (auto const& s : in)
+          add(whole, s);
+      });
+      return whole;
+    }
+
+    table_type fusion(std::vector<unsigned int> const& A_to_B,
+                      table_type const& A, table_type const& B)
+    {
+      // the sizes of the two tables, over all ranks
+      uint64_t sizes[2] = { A.size(), B.size() };
+      std::string mine(reinterpret_cast<char const*>(sizes), sizeof sizes);
+      auto all = net_.all_gather(mine, failed_);
+      uint64_t total[2] = { sizes[0], sizes[1] };
+      for (auto const& s : all) {
+        if (s.empty())
+          continue;
+        reader r(s);
+        total[0] += r.take<uint64_t>();
+        total[1] += r.take<uint64_t>();
+      }
+
+      profile::null_counter counter;
+      table_type result;
+      if (total[0] <= total[1]) {
+        auto whole = gather(A);
+        local([&] { result = op_.table_fusion(A_to_B, whole, B, counter); });
+      } else {
+        auto whole = gather(B);
+        local([&] { result = op_.table_fusion(A_to_B, A, whole, counter); });
+      }
+      redistribute(result);
+      return result;
+    }
+  };
+
+  /*
+   *  The result of the transfer of op on t, with num_processes ranks
+   */
+  template<class Operators>
+  typename Operators::weight_type
+  transfer(Operators const& op, flat_tree const& t, unsigned int num_processes)
+  {
+    static_assert(operators::check<Operators>::value, "not an operator set");
+    auto const P = num_processes;
+
+    // a pair of sockets between every two ranks, fds[r][k] is the end of r
+    std::vector<std::vector<int> > fds(P, std::vector<int>(P, -1));
+    for (unsigned int r = 0; r < P; ++r) {
+      for (unsigned int k = r + 1; k < P; ++k) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+          throw std::runtime_error("cannot create the sockets between processes");
+        fds[r][k] = sv[0];
+        fds[k][r] = sv[1];
+      }
+    }
+    auto close_all_but = [&](unsigned int rank) {
+      for (unsigned int r = 0; r < P; ++r) {
+        for (unsigned int k = 0; k < P; ++k) {
+          if (r != rank and fds[r][k] >= 0)
+            close(fds[r][k]);
+        }
+      }
+    };
+
+    // the children are waited for once the sockets of rank 0 are closed
+    struct reaper {
+      std::vector<pid_t> children;
+      bool failed = false;
+      ~reaper() { wait(); }
+      void wait()
+      {
+        for (auto pid : children) {
+          int status;
+          if (waitpid(pid, &status, 0) < 0 or not WIFEXITED(status) or
+              WEXITSTATUS(status) != 0)
+            failed = true;
+        }
+        children.clear();
+      }
+    } children;
+
+    std::cout.flush();
+    std::cerr.flush();
+    for (unsigned int r = 1; r < P; ++r) {
+      auto pid = fork();
+      if (pid < 0) {
+        close_all_but(0);
+        network net(0, fds[0]);
+        throw std::runtime_error("cannot start the worker processes");
+      }
+      if (pid == 0) {
+        children.children.clear();
+        close_all_but(r);
+        int status = 0;
+        try {
+          network net(r, fds[r]);
+          worker<Operators>(op, t, net).run();
+        } catch (...) {
+          status = 1;
+        }
+        _exit(status);
+      }
+      children.children.push_back(pid);
+    }
+
+    close_all_but(0);
+    network net(0, fds[0]);
+    auto result = worker<Operators>(op, t, net).run();
+    net.close();
+    children.wait();
+    if (children.failed)
+      throw std::runtime_error("a worker process failed");
+    return result;
+  }
+}
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef ESTIMATE_HPP
+#define ESTIMATE_HPP
+
+#include "tree_decomposition/flat_tree.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+/*
+ *  A priori bounds on the cost of the longest_path transfer over a tree
+ *  decomposition, without running it.
+ *
+ *  A state assigns to each vertex of a bag either nothing, a bullet
+ *  (two path edges) or a strand end (one path edge); strand ends are
+ *  paired, except for at most two single ends, plus there is the
+ *  finished state. A vertex can only be a strand end if at least one of
+ *  its edges has already been processed, and a bullet if at least two
+ *  have, so the bound for each table only counts the configurations
+ *  allowed by the edges processed in the subtree so far. Pairings are
+ *  counted without any planarity assumption.
+ *
+ *  Memory is estimated for weights of the given size, the peak being the
+ *  largest total size of the tables alive at the same time in the
+ *  post-order transfer.
+ */
+
+namespace estimate {
+  using tree_decomposition::flat_tree;
+
+  // number of states for a1 vertices with one processed edge and a2
+  // vertices with at least two
+  inline long double num_states(unsigned int a1, unsigned int a2)
+  {
+    auto const n = a1 + a2;
+
+    // binomials and pairings with at most two unpaired ends
+    std::vector<std::vector<long double> > binomial(n + 1);
+    for (unsigned int i = 0; i <= n; ++i) {
+      binomial[i].assign(i + 1, 1);
+      for (unsigned int j = 1; j < i; ++j)
+        binomial[i][j] = binomial[i - 1][j - 1] + binomial[i - 1][j];
+    }
+    // (e - 1)!! perfect matchings of e points
+    std::vector<long double> matchings(n + 1, 0);
+    matchings[0] = 1;
+    for (unsigned int e = 2; e <= n; e += 2)
+      matchings[e] = matchings[e - 2] * (e - 1);
+
+    auto pairings = [&](unsigned int e) {
+      long double p = 0;
+      for (unsigned int s = e % 2; s <= std::min(e, 2u); s += 2)
+        p += binomial[e][s] * matchings[e - s];
+      return p;
+    };
+
+    long double total = 1; // the finished state
+    for (unsigned int e1 = 0; e1 <= a1; ++e1) {
+      for (unsigned int e2 = 0; e2 <= a2; ++e2) {
+        total += binomial[a1][e1] * binomial[a2][e2]
+          * std::pow(2.0L, a2 - e2) * pairings(e1 + e2);
+      }
+    }
+    return total;
+  }
+
+  struct report {
+    std::size_t width;
+    std::size_t num_bags;
+    long double max_states;
+    unsigned int max_states_bag;
+    long double joins;
+    long double deletes;
+    long double fusion_pairs;
+    long double peak_memory;
+  };
+
+  // the size in bytes of a weight: a coefficient for each length, as for
+  // the polynomials, or a single value, as for max_plus
+  struct weight_size {
+    std::size_t coefficient;
+    bool per_length;
+  };
+
+  // rough size in bytes of a state of a table of n vertices and weight
+  // of degree at most m
+  inline long double state_bytes(std::size_t n, std::size_t m, weight_size w)
+  {
+    // hash node and bucket, connectivity vector and the weight, with
+    // the vector of the coefficients
+    auto const weight = w.per_length ? 32 + (m + 1) * (long double) w.coefficient
+                                     : (long double) w.coefficient;
+    return 96 + 16 * ((n + 15) / 16) + weight;
+  }
+
+  inline report estimate(flat_tree const& t, weight_size w)
+  {
+    using uint = tree_decomposition::uint;
+
+    report r = report();
+    r.width = t.max_bag_size() - 1;
+    r.num_bags = t.size();
+
+    // for each vertex, the bags holding its edges, and edges per bag
+    std::vector<std::vector<uint> > edge_bags;
+    std::vector<std::size_t> edges_upto(t.size() + 1, 0);
+    for (uint b = 0; b < t.size(); ++b) {
+      for (auto e : t.edges(b)) {
+        auto m = std::max(e.first, e.second);
+        if (m >= edge_bags.size())
+          edge_bags.resize(m + 1);
+        edge_bags[e.first].push_back(b);
+        edge_bags[e.second].push_back(b);
+      }
+      edges_upto[b + 1] = edges_upto[b] + (t[b].edge_end - t[b].edge_begin);
+    }
+
+    // processed edges at v within bags [lo, hi]
+    auto degree = [&](uint v, uint lo, uint hi) -> std::size_t {
+      if (v >= edge_bags.size() or hi < lo)
+        return 0;
+      auto const& l = edge_bags[v];
+      return std::upper_bound(l.begin(), l.end(), hi)
+        - std::lower_bound(l.begin(), l.end(), lo);
+    };
+
+    // states and bytes of a table on the given vertices, with the edges
+    // in bags [lo, hi] processed
+    struct table { long double states, bytes; };
+    auto bound = [&](std::vector<uint> const& vs, uint lo, uint hi) {
+      unsigned int a1 = 0, a2 = 0;
+      for (auto v : vs) {
+        auto d = degree(v, lo, hi);
+        if (d == 1)
+          ++ a1;
+        else if (d > 1)
+          ++ a2;
+      }
+      table tb;
+      tb.states = num_states(a1, a2);
+      auto m = hi < lo ? 0 : edges_upto[hi + 1] - edges_upto[lo];
+      tb.bytes = tb.states * state_bytes(vs.size(), m, w);
+      return tb;
+    };
+
+    // outputs of the subtrees waiting for their parent
+    std::vector<std::pair<uint, table> > pending;
+    long double pending_bytes = 0;
+    auto peak = [&](long double live) {
+      r.peak_memory = std::max(r.peak_memory, pending_bytes + live);
+    };
+
+    for (uint b = 0; b < t.size(); ++b) {
+      std::vector<uint> vs(t.vertices(b).begin(), t.vertices(b).end());
+      table acc = { 1, state_bytes(vs.size(), 0, w) };
+
+      auto const first_child = pending.size() - t[b].num_children;
+      for (auto k = first_child; k < pending.size(); ++k) {
+        auto const c = pending[k].first;
+        auto child = pending[k].second;
+        pending_bytes -= child.bytes;
+
+        std::vector<uint> left_over(t.vertices(c).begin(), t.vertices(c).end());
+        for (auto v : t.vertices(c)) {
+          if (t.has(b, v))
+            continue;
+          left_over.erase(std::find(left_over.begin(), left_over.end(), v));
+          auto out = bound(left_over, t.first(c), c);
+          out.states = std::min(out.states, child.states);
+          out.bytes = std::min(out.bytes, child.bytes);
+          r.deletes += child.states;
+          peak(acc.bytes + child.bytes + out.bytes);
+          child = out;
+        }
+
+        // children subtrees are consecutive, ending with c
+        auto out = bound(vs, t.first(pending[first_child].first), c);
+        out.states = std::min(out.states, acc.states * child.states);
+        r.fusion_pairs += acc.states * child.states;
+        peak(acc.bytes + child.bytes + out.bytes);
+        acc = out;
+      }
+      pending.erase(pending.begin() + first_child, pending.end());
+
+      // the joins, one edge at a time
+      auto const num_edges = t[b].edge_end - t[b].edge_begin;
+      for (uint k = 0; k < num_edges; ++k) {
+        r.joins += acc.states;
+        auto out = bound(vs, t.first(b), b);
+        out.states = std::min(out.states, acc.states * 2);
+        out.bytes = std::min(out.bytes, acc.bytes * 2);
+        peak(acc.bytes + out.bytes);
+        acc = out;
+      }
+
+      if (acc.states > r.max_states) {
+        r.max_states = acc.states;
+        r.max_states_bag = b;
+      }
+      pending.push_back(std::make_pair(b, acc));
+      pending_bytes += acc.bytes;
+    }
+
+    // closing off the root
+    r.deletes += t.bag_size(t.root()) * pending.back().second.states;
+    return r;
+  }
+
+  inline std::ostream& operator<<(std::ostream& o, report const& r)
+  {
+    o << "width: " << r.width << "\n"
+      << "bags: " << r.num_bags << "\n"
+      << "max_states: " << static_cast<double>(r.max_states)
+      << " (bag " << r.max_states_bag << ")\n"
+      << "join_states: " << static_cast<double>(r.joins) << "\n"
+      << "delete_states: " << static_cast<double>(r.deletes) << "\n"
+      << "fusion_pairs: " << static_cast<double>(r.fusion_pairs) << "\n"
+      << "peak_memory_bytes: " << static_cast<double>(r.peak_memory) << "\n";
+    return o;
+  }
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef LATTICE_HPP
+#define LATTICE_HPP
+
+#include "graph_type.hpp"
+#include "parse_graph.hpp"
+
+#include <boost/lexical_cast.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ *  Generators for strips of common lattices. A lattice of width W and
+ *  length L has W * L vertices, vertex (x, y) with 0 <= x < L (column)
+ *  and 0 <= y < W (row) has index x * W + y. Every edge joins vertices
+ *  in the same column or in adjacent columns, so eliminating vertices
+ *  in index order gives the usual transfer matrix decomposition, column
+ *  by column.
+ */
+
+namespace lattice {
+  enum class lattice_type { square, cylinder, triangular, honeycomb };
+
+  struct lattice {
+    lattice_type type;
+    unsigned int width;
+    unsigned int length;
+    graph_type graph;
+    std::vector<unsigned int> order;
+
+    unsigned int index(unsigned int x, unsigned int y) const
+    {
+      return x * width + y;
+    }
+  };
+
+  inline lattice_type parse_lattice_type(std::string const& s)
+  {
+    if (s == "square")
+      return lattice_type::square;
+    if (s == "cylinder")
+      return lattice_type::cylinder;
+    if (s == "triangular")
+      return lattice_type::triangular;
+    if (s == "honeycomb")
+      return lattice_type::honeycomb;
+    throw std::runtime_error("unknown lattice type " + s);
+  }
+
+  inline lattice make_lattice(lattice_type type, unsigned int width,
+                              unsigned int length)
+  {
+    if (width == 0 or length == 0)
+      throw std::runtime_error("lattice dimensions must be positive");
+    if (type == lattice_type::cylinder and width < 3)
+      throw std::runtime_error("a cylinder needs width at least 3");
+
+    lattice l;
+    l.type = type;
+    l.width = width;
+    l.length = length;
+
+    std::vector<std::pair<unsigned int, unsigned int> > edges;
+    for (unsigned int x = 0; x < length; ++x) {
+      for (unsigned int y = 0; y < width; ++y) {
+        // vertical edges, within column x
+        if (y + 1 < width) {
+          // the honeycomb lattice as a brick wall
+          if (type != lattice_type::honeycomb or (x + y) % 2 == 0)
+            edges.emplace_back(l.index(x, y), l.index(x, y + 1));
+        } else if (type == lattice_type::cylinder) {
+          edges.emplace_back(l.index(x, 0), l.index(x, y));
+        }
+        // horizontal edges, to column x + 1
+        if (x + 1 < length) {
+          edges.emplace_back(l.index(x, y), l.index(x + 1, y));
+          if (type == lattice_type::triangular and y + 1 < width)
+            edges.emplace_back(l.index(x, y), l.index(x + 1, y + 1));
+        }
+      }
+    }
+
+    l.graph = make_graph(edges, width * length);
+    for (unsigned int i = 0; i < width * length; ++i)
+      l.order.push_back(i);
+    return l;
+  }
+
+  /*
+   *  Edge classes for counting by direction: 0 (x) for horizontal edges,
+   *  1 (y) for vertical ones and 2 (z) for the diagonals of the
+   *  triangular lattice.
+   */
+  inline unsigned int edge_class(lattice const& l, unsigned int u, unsigned int v)
+  {
+    if (u / l.width == v / l.width)
+      return 1;
+    return u % l.width == v % l.width ? 0 : 2;
+  }
+
+  /*
+   *  The reflection y -> W - 1 - y of every column, when it is an
+   *  automorphism of the lattice, otherwise an empty vector. It is for
+   *  square and cylinder lattices, and for the honeycomb lattice of even
+   *  width; the diagonals of the triangular lattice all go the same way.
+   */
+  inline std::vector<unsigned int> reflection(lattice const& l)
+  {
+    std::vector<unsigned int> sigma;
+    if (l.type == lattice_type::triangular or
+        (l.type == lattice_type::honeycomb and l.width % 2 != 0))
+      return sigma;
+    for (unsigned int x = 0; x < l.length; ++x)
+      for (unsigned int y = 0; y < l.width; ++y)
+        sigma.push_back(l.index(x, l.width - 1 - y));
+    return sigma;
+  }
+
+  // parse a specification like "square:4x10"
+  inline lattice parse_lattice(std::string const& s)
+  {
+    auto colon = s.find(':');
+    auto times = s.find('x', colon);
+    if (colon == std::string::npos or times == std::string::npos)
+      throw std::runtime_error("expecting TYPE:WxL, got " + s);
+    try {
+      return make_lattice(parse_lattice_type(s.substr(0, colon)),
+        boost::lexical_cast<unsigned int>(s.substr(colon + 1, times - colon - 1)),
+        boost::lexical_cast<unsigned int>(s.substr(times + 1)));
+    } catch (boost::bad_lexical_cast&) {
+      throw std::runtime_error("expecting TYPE:WxL, got " + s);
+    }
+  }
+}
+
+#endif
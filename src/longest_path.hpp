@@ -22,18 +22,40 @@
 #include "boost/format.hpp"
 #include "boost/math/tools/polynomial.hpp"
 #include "boost/range/algorithm/count.hpp"
+#include "boost/range/algorithm/count_if.hpp"
 #include "boost/range/algorithm/find_if.hpp"
+#include "boost/range/algorithm/max_element.hpp"
 #include "boost/range/algorithm/replace.hpp"
-#include "boost/unordered/unordered_map.hpp"
 
 #include "boost/optional.hpp"
 
-template<class Weight>
-struct longest_path
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "connectivity.hpp"
+#include "profile.hpp"
+#include "representative.hpp"
+#include "tables.hpp"
+#include "utility/addmul.hpp"
+
+// Table is hash_table or sorted_table, see tables.hpp
+template<class Weight, template<class, class> class Table = hash_table>
+struct longest_path : connectivity_states
 {
   using weight_type = Weight ;
-  using connectivity = std::vector<int8_t>;
-  using table_type = boost::unordered_map<connectivity, weight_type>;
+  using state_type = connectivity;
+  using table_type = Table<connectivity, weight_type>;
+
+  // whether the transfer should drop dead states, see prune_operator, and
+  // keep only a representative set of the others, see reduce_operator
+  bool prune;
+  bool reduce;
+
+  explicit longest_path(bool prune = false, bool reduce = false)
+    : prune(prune), reduce(reduce) { }
 
   static bool is_endpoint(connectivity const& c, size_t i)
   {
@@ -102,84 +124,28 @@ struct longest_path
     return c;
   }
 
-  static connectivity canonicalize(connectivity c)
-  {
-    const auto max = 50;
-    int8_t table[max];
-    boost::fill(table, 0);
-
-    // starts recounting from 1
-    auto k = 1;
-    for (auto& x : c) {
-      if (x <= 0)
-        continue;
-      if (table[x] != 0) {
-        x = table[x];
-      } else {
-        table[x] = k;
-        x = k;
-        ++ k;
-      }
-    }
-    return c;
-  }
-
-  static size_t how_many_endpoints(connectivity const& c)
-  {
-    std::vector<int> table(c.size() + 1, -1);
-    size_t result = 0;
-    for (size_t j = 0; j < c.size(); ++j) {
-      if (c[j] > 0) {
-        if (table[c[j]] < 0) {
-          table[c[j]] = j;
-          result ++;
-        } else {
-          result --;
-        }
-      }
-    }
-    return result;
-  }
-
-  static bool is_empty(connectivity const& c)
-  {
-    return not c.empty() and boost::count_if(c, [](int x) { return x != 0; }) == 0;
-  }
-
-  static bool is_finished(connectivity const& c)
-  {
-    return c.empty();
-  }
-
-  template<class F>
-  static void decompose(connectivity const& c, F f)
+  static table_type empty_state(size_t size)
   {
-    std::map<size_t, size_t> table;
-
-    auto j = 0;
-    for (auto& x : c) {
-      if (x <= 0)
-        continue;
-      if (table[x] != -1)
-        f(table[x], j);
-      table[x] = j;
-      j ++;
-    }
+    return table_type{ { connectivity(size), weight_type(1) } };
   }
 
-  static table_type empty_state(size_t size)
+  // the result, once every vertex has been deleted
+  static weight_type finish(table_type const& table)
   {
-    return table_type{ { connectivity(size), weight_type(1) } };
+    assert(table.size() == 1);
+    return table.begin()->second;
   }
 
+  // the edge is of class c, see mul_var
   table_type
-  join_operator(size_t i, size_t j, table_type const& table) const
+  join_operator(size_t i, size_t j, table_type const& table,
+                unsigned int c = 0) const
   {
     table_type new_table{table};
     for (auto const& state : table) {
       auto maybe_newc = connect(state.first, i, j);
       if (maybe_newc and how_many_endpoints(*maybe_newc) <= 2) {
-        new_table[canonicalize(*maybe_newc)] += (state.second << 1);
+        new_table[canonicalize(*maybe_newc)] += mul_var(state.second, c);
       }
     }
     return new_table;
@@ -217,103 +183,211 @@ struct longest_path
     return new_table;
   }
 
+  /*
+   *  A strand end on an exhausted vertex (one with no edges left) can
+   *  only be an endpoint of the path, as is the deleted end of a strand
+   *  with a single end in the bag. A state is dead if this makes more
+   *  than two endpoints, or a strand with both endpoints fixed together
+   *  with another strand.
+   */
+  template<class Mask>
+  static bool is_dead(connectivity const& c, Mask const& exhausted)
+  {
+    if (is_finished(c))
+      return false;
+
+    std::bitset<max_labels> seen, odd;
+    uint8_t fixed[max_labels];
+    for (size_t i = 0; i < c.size(); ++i) {
+      auto const x = c[i];
+      if (x <= 0)
+        continue;
+      if (not seen[x]) {
+        seen.set(x);
+        fixed[x] = 0;
+      }
+      odd.flip(x);
+      fixed[x] += exhausted[i] ? 1 : 0;
+    }
+
+    size_t endpoints = 0;
+    bool complete = false;
+    for (size_t x = 1; x < max_labels; ++x) {
+      if (not seen[x])
+        continue;
+      auto const f = fixed[x] + odd[x];
+      endpoints += f;
+      complete = complete or f == 2;
+    }
+    return endpoints > 2 or (complete and seen.count() > 1);
+  }
+
+  template<class Mask>
+  table_type
+  prune_operator(Mask const& exhausted, table_type table) const
+  {
+    drop_if(table, [&](typename table_type::value_type const& state) {
+      return is_dead(state.first, exhausted);
+    });
+    return table;
+  }
+
+  // only max-plus weights can be reduced, see representative.hpp
+  table_type reduce_operator(table_type const& table) const
+  {
+    return representative::reduce(table);
+  }
+
   template<class Mapping>
   table_type
   table_fusion(Mapping A_to_B, table_type const& A_table, table_type const& B_table) const
   {
-    table_type new_table;
-    for (auto const& stateA : A_table) {
-      for (auto const& stateB : B_table) {
-        // if state A is finished
-        if (is_finished(stateA.first)) {
-          if (is_empty(stateB.first)) {
-            new_table[connectivity()] += stateA.second * stateB.second;
-          }
-          continue;
-        }
+    profile::null_counter counter;
+    return table_fusion(A_to_B, A_table, B_table, counter);
+  }
 
-        // if state B is finished
-        if (is_finished(stateB.first)) {
-          if (is_empty(stateA.first)) {
-            new_table[connectivity()] += stateA.second * stateB.second;
-          }
-          continue;
-        }
+  // the state of A, whose vertex i goes to position A_to_B[i] of a bag of
+  // n vertices
+  template<class Mapping>
+  static connectivity in_order(connectivity const& a, Mapping const& A_to_B, size_t n)
+  {
+    connectivity newa(n);
+    for (size_t i = 0; i < a.size(); ++i)
+      newa[A_to_B[i]] = a[i];
+    return newa;
+  }
 
-        // n is the size of the destination (stateB)
-        auto const n = stateB.first.size();
+  /*
+   *  The state made of stateA and stateB together, or none if they do not
+   *  go together. newa is stateA in the order of B (see in_order), unless
+   *  one of the two is finished.
+   */
+  static boost::optional<connectivity>
+  fuse(connectivity const& stateA, connectivity const& newa,
+       connectivity const& stateB)
+  {
+    // if state A is finished
+    if (is_finished(stateA)) {
+      if (is_empty(stateB))
+        return connectivity();
+      return {};
+    }
 
-        // convert to the new order
-        connectivity newa(n);
-        for (auto i = 0; i < stateA.first.size(); ++i)
-          newa[A_to_B[i]] = stateA.first[i];
-
-        connectivity newc(stateB.first);
-
-        bool valid = true;
-        std::map<size_t, size_t> table;
-        for (size_t i = 0; i < n; ++i) {
-          if (newa[i] > 0) {
-            // a strand connected or not
-            if (table.find(newa[i]) != table.end()) {
-              // we have a link
-              auto j = table[newa[i]];
-              // go ahead and connect
-              if (auto maybe_newc = connect(newc, i, j)) {
-                newc = *maybe_newc;
-              } else {
-                valid = false;
-                break;
-              }
-              table.erase(newa[i]);
-            } else {
-              table[newa[i]] = i;
-            }
-          }
-          // a bullet
-          if (newa[i] == -1) {
-            if (newc[i] != 0) {
-              valid = false;
-              break;
-            }
-            newc[i] = -1;
-          }
-        }
-        if (not valid) {
-          continue;  // to exit the 'for' (to the next pair of states)
+    // if state B is finished
+    if (is_finished(stateB)) {
+      if (is_empty(stateA))
+        return connectivity();
+      return {};
+    }
+
+    // n is the size of the destination (stateB)
+    auto const n = stateB.size();
+    connectivity newc(stateB);
+
+    // strands of A with only one end seen so far, and its position
+    std::bitset<max_labels> open;
+    size_t table[max_labels];
+    int8_t max_label = 0;
+    // once a strand of A closes the path, only bullets of A on vertices
+    // unused in B can follow: they are checked against newc as it was
+    bool closed = false;
+    for (size_t i = 0; i < n; ++i) {
+      auto const x = newa[i];
+      if (x > 0) {
+        if (closed)
+          return {};
+        max_label = std::max(max_label, x);
+        // a strand connected or not
+        if (open[x]) {
+          // we have a link
+          auto j = table[x];
+          // go ahead and connect
+          auto maybe_newc = connect(newc, i, j);
+          if (not maybe_newc)
+            return {};
+          if (is_finished(*maybe_newc))
+            closed = true;
+          else
+            newc = *maybe_newc;
+          open.reset(x);
+        } else {
+          open.set(x);
+          table[x] = i;
         }
-        // now the single strands
-        for (auto x : table) {
-          // discard the state if we have single strands to apply to a finished state
-          if (is_finished(newc)) {
+      }
+      // a bullet
+      if (newa[i] == -1) {
+        if (newc[i] != 0)
+          return {};
+        newc[i] = -1;
+      }
+    }
+    if (closed) {
+      if (open.any())
+        return {};
+      return connectivity();
+    }
+
+    bool valid = true;
+    // now the single strands, in label order
+    for (int8_t x = 1; x <= max_label; ++x) {
+      if (not open[x])
+        continue;
+      // discard the state if we have single strands to apply to a finished state
+      if (is_finished(newc)) {
+        valid = false;
+        break;
+      }
+      auto bi = table[x];
+      switch (newc[bi]) {
+        case -1:
+          valid = false;
+          break;
+        case 0:
+          newc = detach(newc, bi);
+          break;
+        default:
+          // we can do this only if there is nothing else
+          if (boost::count(newc, newc[bi]) == 2) {
+            // part of a pair
+            newc[bi] = -1;
+          } else if (boost::count_if(newc, [](int x) { return x > 0; }) == 1) {
+            // single strand
+            newc.clear(); // mark as finished
+          } else {
+            // there's other stuff
             valid = false;
-            break;
-          }
-          auto bi = x.second;
-          switch (newc[bi]) {
-            case -1:
-              valid = false;
-              break;
-            case 0:
-              newc = detach(newc, bi);
-              break;
-            default:
-              // we can do this only if there is nothing else
-              if (boost::count(newc, newc[bi]) == 2) {
-                // part of a pair
-                newc[bi] = -1;
-              } else if (boost::count_if(newc, [](int x) { return x > 0; }) == 1) {
-                // single strand
-                newc.clear(); // mark as finished
-              } else {
-                // there's other stuff
-                valid = false;
-                continue;
-              }
+            continue;
           }
-        }
-        if (valid and how_many_endpoints(newc) <= 2) {
-          new_table[canonicalize(newc)] += stateA.second * stateB.second;
+      }
+    }
+    if (valid and how_many_endpoints(newc) <= 2)
+      return canonicalize(newc);
+    return {};
+  }
+
+  // the counter is told about every pair of states examined and accepted
+  template<class Mapping, class Counter>
+  table_type
+  table_fusion(Mapping A_to_B, table_type const& A_table,
+               table_type const& B_table, Counter& counter) const
+  {
+    table_type new_table;
+    for (auto const& stateA : A_table) {
+      // stateA in the order of B, the same for every state of B of a size
+      connectivity newa;
+      for (auto const& stateB : B_table) {
+        counter.examined();
+
+        // convert to the new order, unless either is finished
+        auto const n = stateB.first.size();
+        if (n != newa.size() and not is_finished(stateB.first) and
+            not is_finished(stateA.first))
+          newa = in_order(stateA.first, A_to_B, n);
+
+        if (auto newc = fuse(stateA.first, newa, stateB.first)) {
+          counter.accepted();
+          addmul(new_table[*newc], stateA.second, stateB.second);
         }
       }
     }
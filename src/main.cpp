@@ -11,15 +11,28 @@
  *
  */
 
+#include "batch.hpp"
 #include "chinese_remainder.hpp"
+#include "cycles.hpp"
+#include "distributed.hpp"
+#include "estimate.hpp"
 #include "graph_type.hpp"
+#include "lattice.hpp"
 #include "parse_graph.hpp"
+#include "profile.hpp"
+#include "sample.hpp"
+#include "server.hpp"
+#include "strip.hpp"
 #include "transfer.hpp"
 #include "tree_decomposition/heuristics.hpp"
+#include "tree_decomposition/serialization.hpp"
 #include "tree_decomposition/tree_decomposition.hpp"
 #include "longest_path.hpp"
+#include "utility/fixed_uint.hpp"
 #include "utility/gmp.hpp"
+#include "utility/mpolynomial.hpp"
 #include "utility/polynomial.hpp"
+#include "utility/semiring.hpp"
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/connected_components.hpp>
@@ -33,6 +46,9 @@
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -60,30 +76,519 @@ bool validate_elimination_order(Range range, Graph const& g)
 }
 
 /*
- *  The algorithm to run, dependent on the weight type
+ *  The problems to solve, each an operator set dependent on the weight type
  */
 
 template<typename T>
-using algo = longest_path<polynomial<T>>;
+using path_algo = longest_path<polynomial<T>>;
 
-int main (int argc, char *argv[])
+template<typename T>
+using cycle_algo = cycles<polynomial<T>>;
+
+// the same, counting each class of edges with its own variable
+template<typename T>
+using path_classes_algo = longest_path<mpolynomial<T>>;
+
+template<typename T>
+using cycle_classes_algo = cycles<mpolynomial<T>>;
+
+// the same for the transfer on a tree decomposition, with the tables of the
+// given kind
+template<template<class, class> class Table>
+struct problems
+{
+  template<typename T>
+  using path = longest_path<polynomial<T>, Table>;
+
+  template<typename T>
+  using cycle = cycles<polynomial<T>, Table>;
+
+  template<typename T>
+  using path_classes = longest_path<mpolynomial<T>, Table>;
+
+  template<typename T>
+  using cycle_classes = cycles<mpolynomial<T>, Table>;
+
+  // the weights themselves, for the semirings of semiring.hpp
+  template<typename W>
+  using path_weights = longest_path<W, Table>;
+
+  template<typename W>
+  using cycle_weights = cycles<W, Table>;
+};
+
+enum class problem { path, cycle };
+
+problem parse_problem(std::string const& s)
+{
+  if (s == "path")
+    return problem::path;
+  if (s == "cycle")
+    return problem::cycle;
+  throw std::runtime_error("unknown problem " + s);
+}
+
+/*
+ *  The counts are computed with fixed width integers first, and again with
+ *  mpz_int if they overflow. A run is a class with a member template
+ *  with<Integer>() doing the work for a given integer type.
+ */
+
+template<class Run>
+int with_integers(unsigned int bits, Run& run)
+{
+  try {
+    switch (bits) {
+      case 0:
+        break;
+      case 64:
+        return run.template with<fixed::uint64>();
+      case 128:
+        return run.template with<fixed::uint128>();
+      case 256:
+        return run.template with<fixed::uint256>();
+      default:
+        throw std::runtime_error("integers of 64, 128 or 256 bits only");
+    }
+  } catch (fixed::overflow const&) {
+    std::cerr << "The counts overflow " << bits << " bits, starting again with mpz_int\n";
+  }
+  return run.template with<gmp::mpz_int>();
+}
+
+// prints the results of a strip as they come, the lengths printed before
+// an overflow are not printed again
+template<template<class> class Algorithm>
+struct strip_run
+{
+  lattice::lattice const& l;
+  std::vector<unsigned int> const& sigma;
+  unsigned int printed;
+
+  strip_run(lattice::lattice const& l, std::vector<unsigned int> const& sigma)
+    : l(l), sigma(sigma), printed(0)
+  {
+  }
+
+  template<class Integer>
+  int with()
+  {
+    strip::transfer(Algorithm<Integer>(), l,
+      [this](unsigned int length, typename Algorithm<Integer>::weight_type const& result) {
+        if (length > printed) {
+          std::cout << length << ": " << result << "\n";
+          printed = length;
+        }
+      }, sigma);
+    return 0;
+  }
+};
+
+template<class Operators>
+int run_transfer(Operators const& op, tree_decomposition::flat_tree const& flat,
+                 boost::program_options::variables_map const& vm, std::ostream& out)
+{
+  if (vm.count("profile")) {
+    auto filename = vm["profile"].as<std::string>();
+    std::ofstream o(filename);
+    if (not o.is_open()) {
+      std::cerr << "error: cannot write " << filename << "\n";
+      return 1;
+    }
+    profile::trace_profiler prof;
+    out << transfer::transfer(op, flat, prof, vm.count("memoize"));
+    prof.write(o);
+  } else {
+    profile::null_profiler prof;
+    out << transfer::transfer(op, flat, prof, vm.count("memoize"));
+  }
+  return 0;
+}
+
+template<template<class> class Algorithm>
+struct tree_run
+{
+  tree_decomposition::flat_tree const& flat;
+  boost::program_options::variables_map const& vm;
+  std::ostream& out;
+
+  tree_run(tree_decomposition::flat_tree const& flat,
+           boost::program_options::variables_map const& vm, std::ostream& out)
+    : flat(flat), vm(vm), out(out)
+  {
+  }
+
+  template<class Integer>
+  int with()
+  {
+    Algorithm<Integer> op(vm.count("prune"), vm.count("reduce"));
+    // not a job option, a server runs each job in one process
+    auto const processes = vm.count("processes") ? vm["processes"].as<unsigned int>() : 1;
+    if (processes > 1) {
+      out << distributed::transfer(op, flat, processes);
+      return 0;
+    }
+    return run_transfer(op, flat, vm, out);
+  }
+};
+
+// prints longest paths drawn at random, or one of them, see sample.hpp
+template<template<class, class> class Table>
+struct sample_run
+{
+  tree_decomposition::flat_tree const& flat;
+  boost::program_options::variables_map const& vm;
+  // the vertices are printed numbered as in the input
+  unsigned int first_vertex;
+  std::ostream& out;
+
+  sample_run(tree_decomposition::flat_tree const& flat,
+             boost::program_options::variables_map const& vm,
+             unsigned int first_vertex, std::ostream& out)
+    : flat(flat), vm(vm), first_vertex(first_vertex), out(out)
+  {
+  }
+
+  template<class Integer>
+  int with()
+  {
+    using weight_type = longest_count<Integer>;
+    longest_path<weight_type, Table> op(vm.count("prune"));
+    weight_type weight;
+    std::vector<std::vector<unsigned int> > paths;
+    if (vm.count("witness")) {
+      paths = sample::paths(op, flat, 1, sample::first(), weight);
+    } else {
+      std::mt19937_64 rng(vm["seed"].as<unsigned long>());
+      paths = sample::paths(op, flat, vm["sample"].as<unsigned int>(),
+                            sample::uniform<std::mt19937_64>(rng), weight);
+    }
+    std::cerr << "Longest paths: " << weight << "\n";
+    for (auto const& p : paths) {
+      for (std::size_t i = 0; i < p.size(); ++i)
+        out << (i > 0 ? " " : "") << p[i] + first_vertex;
+      out << "\n";
+    }
+    return 0;
+  }
+};
+
+// bound is passed on to the chinese remainder, see there
+template<template<class> class Algorithm>
+int run(tree_decomposition::flat_tree const& flat,
+        boost::program_options::variables_map const& vm, unsigned int bits,
+        std::vector<gmp::mpz_int> const& bound, std::ostream& out)
+{
+  if (vm.count("chinese-remainder")) {
+    out << chinese_remainder::chinese_remainder<Algorithm>(flat, bound, vm.count("prune"));
+    return 0;
+  }
+  tree_run<Algorithm> r(flat, vm, out);
+  return with_integers(bits, r);
+}
+
+// the counts with the tables of the given kind, see tables.hpp
+template<template<class, class> class Table>
+int count_with(tree_decomposition::flat_tree const& flat,
+               boost::program_options::variables_map const& vm,
+               problem which, unsigned int bits,
+               std::vector<gmp::mpz_int> const& bound, std::ostream& out)
+{
+  // the longest length only, or the lengths that occur
+  auto const semiring = vm["semiring"].as<std::string>();
+  if (semiring == "max-plus") {
+    switch (which) {
+      case problem::path: {
+        tree_run<problems<Table>::template path_weights> r(flat, vm, out);
+        return r.template with<max_plus>();
+      }
+      case problem::cycle: {
+        tree_run<problems<Table>::template cycle_weights> r(flat, vm, out);
+        return r.template with<max_plus>();
+      }
+    }
+  }
+  if (semiring == "boolean") {
+    switch (which) {
+      case problem::path: {
+        tree_run<problems<Table>::template path> r(flat, vm, out);
+        return r.template with<boolean>();
+      }
+      case problem::cycle: {
+        tree_run<problems<Table>::template cycle> r(flat, vm, out);
+        return r.template with<boolean>();
+      }
+    }
+  }
+
+  if (vm.count("edge-classes")) {
+    switch (which) {
+      case problem::path: {
+        tree_run<problems<Table>::template path_classes> r(flat, vm, out);
+        return with_integers(bits, r);
+      }
+      case problem::cycle: {
+        tree_run<problems<Table>::template cycle_classes> r(flat, vm, out);
+        return with_integers(bits, r);
+      }
+    }
+  }
+
+  switch (which) {
+    case problem::path:
+      return run<problems<Table>::template path>(flat, vm, bits, bound, out);
+    case problem::cycle:
+      return run<problems<Table>::template cycle>(flat, vm, bits, bound, out);
+  }
+  return 0;
+}
+
+/*
+ *  Counts on the decomposition of g, writing the result to out. classes
+ *  is the class of each edge of g, by edge index.
+ */
+int count(graph_type const& g, std::vector<unsigned int> const& classes,
+          tree_decomposition::flat_tree& flat,
+          boost::program_options::variables_map const& vm,
+          problem which, unsigned int bits, std::ostream& out)
+{
+  if (vm.count("edge-classes")) {
+    // look up the class of each edge of the decomposition
+    boost::unordered_map<std::pair<unsigned int, unsigned int>, unsigned int> class_of;
+    for (auto e : as_range(edges(g))) {
+      auto a = get(boost::vertex_index, g, source(e, g));
+      auto b = get(boost::vertex_index, g, target(e, g));
+      class_of[std::minmax(a, b)] = classes[get(boost::edge_index, g, e)];
+    }
+    flat.set_edge_classes([&](unsigned int a, unsigned int b) {
+      return class_of[std::minmax(a, b)];
+    });
+  }
+
+  // every path or cycle of k edges is a subset of k edges
+  std::vector<gmp::mpz_int> bound;
+  if (vm.count("crt-bound")) {
+    auto const m = num_edges(g);
+    bound.push_back(1);
+    for (std::size_t k = 1; k <= m; ++k)
+      bound.push_back(bound.back() * (m - k + 1) / k);
+  }
+
+  if (vm["backend"].as<std::string>() == "sorted")
+    return count_with<sorted_table>(flat, vm, which, bits, bound, out);
+  return count_with<hash_table>(flat, vm, which, bits, bound, out);
+}
+
+// with --sample or --witness, the paths instead of their counts
+int sample_paths(tree_decomposition::flat_tree const& flat,
+                 boost::program_options::variables_map const& vm,
+                 problem which, unsigned int bits, unsigned int first_vertex,
+                 std::ostream& out)
+{
+  if (which != problem::path)
+    throw std::runtime_error("only paths can be sampled");
+  if (vm["backend"].as<std::string>() == "sorted") {
+    sample_run<sorted_table> r(flat, vm, first_vertex, out);
+    return with_integers(bits, r);
+  }
+  sample_run<hash_table> r(flat, vm, first_vertex, out);
+  return with_integers(bits, r);
+}
+
+// the elimination order given by the heuristic chosen on the command line
+template<class OutputIterator>
+void heuristic_order(graph_type const& g,
+                     boost::program_options::variables_map const& vm,
+                     OutputIterator out)
+{
+  if (vm.count("fill-in"))
+    heuristics::greedy_fillin_order(g, out);
+  else if (vm.count("local-degree"))
+    heuristics::greedy_local_degree_order(g, out);
+  else if (vm.count("local-fill-in"))
+    heuristics::greedy_local_fillin_order(g, out);
+  else
+    heuristics::greedy_degree_order(g, out);
+}
+
+bool is_connected(graph_type const& g)
+{
+  auto component = boost::make_vector_property_map<int>(
+    get(boost::vertex_index, g));
+  return connected_components(g, component) <= 1;
+}
+
+/*
+ *  The options of a single job, on the command line or in a request to the
+ *  server.
+ */
+boost::program_options::options_description job_options()
 {
   namespace po = boost::program_options;
-  po::options_description desc("Allowed options");
+  po::options_description desc("Job options");
   desc.add_options()
-  ("help,h", "Produce help message")
-  ("input-file", po::value<std::string>(), "Read the graph from a file.")
   // tree decomposition options
   ("degree", "Use greedy degree algorithm [default].")
   ("fill-in", "Use greedy fill-in algorithm.")
   ("local-degree", "Use 'local' greedy degree algorithm.")
   ("local-fill-in", "Use 'local' greedy fill-in algorithm.")
+  // transfer options
+  ("problem", po::value<std::string>(), "What to count: path [default] (paths by length) or cycle (cycles by length).")
+  ("semiring", po::value<std::string>()->default_value("count"), "What to compute for each length: count (the number of paths or cycles, as a polynomial), max-plus (only the longest length in edges, 0 if there is no cycle) or boolean (whether the length occurs, as a polynomial with unit coefficients).")
+  ("backend", po::value<std::string>()->default_value("hash"), "How to keep the tables of the transfer on a tree decomposition: hash (hash maps) or sorted (arrays sorted by state, merging the states added with a radix sort).")
+  ("chinese-remainder", "Use the chinese remainder trick.")
+  ("crt-bound", "With --chinese-remainder, stop as soon as the modulus covers the number of subsets of k edges for every coefficient of x^k, without a confirming prime.")
+  ("edge-classes", "Count each class of edges with its own variable: x, y, z, w for classes 0..3 of the input, x, y, z for the horizontal, vertical and diagonal edges of a lattice.")
+  ("integer-bits", po::value<unsigned int>()->default_value(128), "Count with integers of 64, 128 or 256 bits, starting again with arbitrary precision if they overflow. 0 uses arbitrary precision from the start.")
+  ("memoize", "Compute the subtrees of the decomposition with the same structure only once. Only subtrees whose bags list their vertices in the same order are recognised as the same.")
+  ("prune", "Drop the states that cannot be completed into a path as early as possible.")
+  ("reduce", "With --semiring max-plus, keep only a representative set of the states (rank based) after the fusions and the joins of each bag, at most 2^(k-1) of each kind for k strand ends. The longest length is the same.")
+  ;
+  return desc;
+}
+
+// throws if the job options do not go together
+void check_job_options(boost::program_options::variables_map const& vm)
+{
+  if (vm.count("degree") + vm.count("fill-in") + vm.count("local-degree") +
+      vm.count("local-fill-in") > 1)
+    throw std::runtime_error("please specify at most one between degree, "
+                             "fill-in, local-degree and local-fill-in");
+  if (vm.count("crt-bound") and not vm.count("chinese-remainder"))
+    throw std::runtime_error("--crt-bound requires --chinese-remainder");
+  if (vm.count("edge-classes") and vm.count("chinese-remainder"))
+    throw std::runtime_error("--edge-classes does not work with --chinese-remainder");
+  auto const bits = vm["integer-bits"].as<unsigned int>();
+  if (bits != 0 and bits != 64 and bits != 128 and bits != 256)
+    throw std::runtime_error("integers of 64, 128 or 256 bits only");
+  if (vm.count("problem"))
+    parse_problem(vm["problem"].as<std::string>());
+  auto const backend = vm["backend"].as<std::string>();
+  if (backend != "hash" and backend != "sorted")
+    throw std::runtime_error("unknown backend " + backend);
+  auto const semiring = vm["semiring"].as<std::string>();
+  if (semiring != "count" and semiring != "max-plus" and semiring != "boolean")
+    throw std::runtime_error("unknown semiring " + semiring);
+  if (vm.count("reduce") and semiring != "max-plus")
+    throw std::runtime_error("--reduce requires --semiring max-plus");
+  if (semiring != "count" and (vm.count("chinese-remainder") or vm.count("edge-classes")))
+    throw std::runtime_error("--semiring " + semiring + " does not work with "
+                             "--chinese-remainder or --edge-classes");
+}
+
+// the options of a request, the server's own ones filling in the rest
+boost::program_options::variables_map
+request_options(std::vector<std::string> const& words,
+                boost::program_options::variables_map const& defaults)
+{
+  namespace po = boost::program_options;
+  auto const desc = job_options();
+  po::variables_map vm;
+  po::store(po::command_line_parser(words).options(desc).run(), vm);
+  po::notify(vm);
+  for (auto const& kv : defaults) {
+    auto i = vm.find(kv.first);
+    if (desc.find_nothrow(kv.first, false) and (i == vm.end() or i->second.defaulted())) {
+      vm.erase(kv.first);
+      vm.insert(kv);
+    }
+  }
+  check_job_options(vm);
+  return vm;
+}
+
+// the size of the weights the options of vm count with, for the estimate
+// of the memory
+estimate::weight_size weight_size(boost::program_options::variables_map const& vm)
+{
+  auto const semiring = vm["semiring"].as<std::string>();
+  if (semiring == "max-plus")
+    return { sizeof(max_plus), false };
+  if (semiring == "boolean")
+    return { sizeof(boolean), true };
+  auto const bits = vm["integer-bits"].as<unsigned int>();
+  // an mpz_int with one or two limbs of its own
+  std::size_t coefficient = bits == 0 ? sizeof(gmp::mpz_int) + 16 : bits / 8;
+  // a term of an mpolynomial holds its monomial too
+  if (vm.count("edge-classes"))
+    coefficient += sizeof(mpolynomial<int>::monomial);
+  return { coefficient, true };
+}
+
+/*
+ *  The fields of the JSON line of a graph of a batch or of a request.
+ *  admit(flat) is called between the decomposition and the transfer.
+ */
+template<class Admit>
+std::string solve(batch::job const& j,
+                  boost::program_options::variables_map const& vm, Admit admit)
+{
+  auto which = problem::path;
+  if (vm.count("problem"))
+    which = parse_problem(vm["problem"].as<std::string>());
+  auto const bits = vm["integer-bits"].as<unsigned int>();
+
+  std::vector<unsigned int> classes;
+  auto g = j.is_file ? read_graph(j.text, graph_format::automatic, &classes)
+                     : parse_graph(j.text, graph_format::edges, &classes);
+  for (auto c : classes) {
+    if (vm.count("edge-classes") and c >= mpolynomial<int>::num_variables)
+      throw std::runtime_error("at most 4 edge classes, numbered from 0");
+  }
+  if (not is_connected(g))
+    throw std::runtime_error("the graph is not connected");
+
+  std::vector<unsigned int> order(num_vertices(g));
+  heuristic_order(g, vm, order.begin());
+  auto td = tree_decomposition::build_tree_decomposition(order, g);
+  tree_decomposition::flat_tree flat(td);
+  admit(flat);
+
+  std::ostringstream result;
+  if (count(g, classes, flat, vm, which, bits, result) != 0)
+    throw std::runtime_error("the transfer failed");
+  auto r = result.str();
+  r.erase(r.find_last_not_of(' ') + 1);
+
+  std::ostringstream fields;
+  fields << "\"vertices\": " << num_vertices(g)
+         << ", \"edges\": " << num_edges(g)
+         << ", \"width\": " << max_bag_size(td) - 1
+         << ", \"result\": " << batch::json_string(r);
+  return fields.str();
+}
+
+int main (int argc, char *argv[])
+{
+  namespace po = boost::program_options;
+  po::options_description desc("Allowed options");
+  desc.add_options()
+  ("help,h", "Produce help message")
+  ("input-file", po::value<std::string>(), "Read the graph from a file.")
+  ("batch", po::value<std::string>(), "Solve many graphs: every file of a directory, or one graph per line (edges format, optionally preceded by an id and a tab) of a file or of stdin (-). Writes a line of JSON per graph.")
+  ("serve", po::value<std::string>(), "Listen on a Unix domain socket for jobs, one per line: id, a tab, a graph in the edges format and optionally a tab and job options. Answers with lines of JSON. The line !shutdown stops the server.")
+  ("connect", po::value<std::string>(), "Send the lines of stdin to a server and print its answers.")
+  ("processes", po::value<unsigned int>()->default_value(1), "Split the transfer on a tree decomposition among this many processes, each holding a part of every table.")
+  ("threads", po::value<unsigned int>()->default_value(0), "With --batch or --serve, the number of threads solving the jobs, otherwise the number of threads sorting the tables with --backend sorted [default: one per core].")
+  ("memory-limit", po::value<unsigned int>()->default_value(0), "With --serve, the estimated memory in MB the running jobs can take together [default: the physical memory].")
+  ("format", po::value<std::string>(), "Input format: auto [default], edges, edge-list or dimacs.")
+  ("lattice", po::value<std::string>(), "Generate a TYPE:WxL lattice strip (square, cylinder, triangular, honeycomb) instead of reading a graph.")
+  ("strip", "With --lattice, compute the results for all lengths 1..L in one pass.")
+  ("symmetry", "With --strip, fold the tables using the reflection of the lattice.")
+  ("automorphism", po::value<std::string>(), "With --strip, fold the tables using this automorphism mapping each column onto itself (image of each vertex, in order).")
+  // tree decomposition options
   ("elimination-order", po::value<std::string>(), "Specify a vertex elimination order.")
+  ("load-tree", po::value<std::string>(), "Load the tree decomposition from a file (PACE format if it ends in .td, binary otherwise).")
+  ("save-tree", po::value<std::string>(), "Save the tree decomposition to a file (PACE format if it ends in .td, binary otherwise).")
   ("print-tree", "Print tree decomposition.")
   ("tree-only", "Print tree decomposition and exit.")
-  // longest_path options
-  ("chinese-remainder", "Use the chinese remainder trick.")
+  ("estimate", "Print estimated table sizes, operation counts and peak memory, and exit.")
+  ("profile", po::value<std::string>(), "Write a per-bag profile of the transfer to a file (Chrome trace format).")
+  ("sample", po::value<unsigned int>(), "Print this many longest paths drawn uniformly at random, one per line as the sequence of their vertices (numbered as in the input), instead of the counts.")
+  ("witness", "Print a longest path, as the sequence of its vertices (numbered as in the input), instead of the counts.")
+  ("seed", po::value<unsigned long>()->default_value(1), "The seed of the random numbers of --sample.")
   ;
+  desc.add(job_options());
 
   po::variables_map vm;
 
@@ -106,29 +611,191 @@ int main (int argc, char *argv[])
   check += vm.count("local-degree");
   check += vm.count("local-fill-in");
   check += vm.count("elimination-order");
+  check += vm.count("load-tree");
 
   if (check > 1) {
     std::cerr <<
       "error: please specify at most one between degree, fill-in,"
-      "local-degree, local-fill-in and elimination-order\n";
+      "local-degree, local-fill-in, elimination-order and load-tree\n";
     return 1;
   }
 
-  graph_type g;
+  if (vm.count("lattice") and (vm.count("input-file") or vm.count("format"))) {
+    std::cerr << "error: please specify either a lattice or an input file\n";
+    return 1;
+  }
+
+  if (vm.count("strip") and not vm.count("lattice")) {
+    std::cerr << "error: --strip requires --lattice\n";
+    return 1;
+  }
+
+  if ((vm.count("symmetry") or vm.count("automorphism")) and not vm.count("strip")) {
+    std::cerr << "error: --symmetry and --automorphism require --strip\n";
+    return 1;
+  }
+
+  if (vm["processes"].as<unsigned int>() > 1 and
+      (vm.count("batch") or vm.count("serve") or vm.count("connect") or
+       vm.count("strip") or vm.count("chinese-remainder") or
+       vm.count("memoize") or vm.count("profile"))) {
+    std::cerr << "error: --processes does not work with --batch, --serve, --connect, "
+                 "--strip, --chinese-remainder, --memoize or --profile\n";
+    return 1;
+  }
+
+  if (vm.count("sample") and vm.count("witness")) {
+    std::cerr << "error: please specify either sample or witness\n";
+    return 1;
+  }
+
+  if ((vm.count("sample") or vm.count("witness")) and
+      (vm.count("batch") or vm.count("serve") or vm.count("connect") or
+       vm.count("strip") or vm["processes"].as<unsigned int>() > 1 or
+       vm.count("chinese-remainder") or vm.count("edge-classes") or
+       vm.count("memoize") or vm.count("reduce") or vm.count("profile") or
+       not vm["semiring"].defaulted())) {
+    std::cerr << "error: --sample and --witness do not work with --batch, --serve, "
+                 "--connect, --strip, --processes, --chinese-remainder, --edge-classes, "
+                 "--memoize, --reduce, --profile or --semiring\n";
+    return 1;
+  }
+
+  // the strip has no tree decomposition and counts in one way only
+  for (auto option : { "backend", "semiring", "prune", "reduce", "memoize",
+                       "chinese-remainder", "estimate", "profile" }) {
+    if (vm.count("strip") and vm.count(option) and not vm[option].defaulted()) {
+      std::cerr << "error: --" << option << " does not work with --strip\n";
+      return 1;
+    }
+  }
+
   try {
-    std::string s;
-    if (vm.count("input-file")) {
-      auto filename = vm["input-file"].as<std::string>();
-      std::ifstream input(filename, std::ios_base::in);
-      if (not input.is_open()) {
-        std::cerr << "error: file " << filename << " not found\n";
+    check_job_options(vm);
+  } catch (std::exception& e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (vm.count("symmetry") and vm.count("automorphism")) {
+    std::cerr << "error: please specify either symmetry or automorphism\n";
+    return 1;
+  }
+
+  if (vm.count("batch") + vm.count("serve") + vm.count("connect") > 1) {
+    std::cerr << "error: please specify at most one between batch, serve and connect\n";
+    return 1;
+  }
+
+  for (auto mode : { "batch", "serve", "connect" }) {
+    for (auto option : { "input-file", "format", "lattice", "elimination-order",
+                         "load-tree", "save-tree", "print-tree", "tree-only",
+                         "estimate", "profile" }) {
+      if (vm.count(mode) and vm.count(option)) {
+        std::cerr << "error: --" << option << " does not work with --" << mode << "\n";
         return 1;
       }
-      input >> s;
+    }
+  }
+
+  graph_type g;
+  std::vector<unsigned int> order;
+  // the class of each edge, by edge index
+  std::vector<unsigned int> classes;
+  // how the input numbers its first vertex, to print paths in its terms
+  unsigned int first_vertex = 0;
+  auto which = problem::path;
+  bool const by_class = vm.count("edge-classes");
+  auto const bits = vm["integer-bits"].as<unsigned int>();
+  try {
+    if (vm.count("problem"))
+      which = parse_problem(vm["problem"].as<std::string>());
+    auto threads = vm["threads"].as<unsigned int>();
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    if (vm.count("batch")) {
+      batch::source jobs(vm["batch"].as<std::string>());
+      batch::run(jobs, threads, [&](batch::job const& j) {
+        return solve(j, vm, [](tree_decomposition::flat_tree const&) { });
+      }, std::cout);
+      return 0;
+    }
+    if (vm.count("serve")) {
+      long double budget = vm["memory-limit"].as<unsigned int>() * 1048576.0L;
+      if (budget == 0)
+        budget = (long double) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+      server::serve(vm["serve"].as<std::string>(), threads, budget,
+        [&](batch::job const& j, std::vector<std::string> const& options,
+            server::context& ctx) {
+          auto job_vm = request_options(options, vm);
+          return solve(j, job_vm, [&](tree_decomposition::flat_tree const& flat) {
+            ctx.admit(estimate::estimate(flat, weight_size(job_vm)).peak_memory);
+          });
+        });
+      return 0;
+    }
+    if (vm.count("connect")) {
+      server::client(vm["connect"].as<std::string>(), std::cin, std::cout);
+      return 0;
+    }
+    // a single job, the threads go to sorting the tables
+    radix::num_threads() = threads;
+    if (vm.count("lattice")) {
+      auto l = lattice::parse_lattice(vm["lattice"].as<std::string>());
+      if (vm.count("strip")) {
+        std::vector<unsigned int> sigma;
+        if (vm.count("symmetry")) {
+          sigma = lattice::reflection(l);
+          if (sigma.empty())
+            throw std::runtime_error("this lattice has no reflection symmetry");
+        } else if (vm.count("automorphism")) {
+          parse_elimination_order(vm["automorphism"].as<std::string>(),
+                                  std::back_inserter(sigma));
+          strip::check_symmetry(l, sigma);
+        }
+        switch (which) {
+          case problem::path:
+            if (by_class) {
+              strip_run<path_classes_algo> r(l, sigma);
+              return with_integers(bits, r);
+            } else {
+              strip_run<path_algo> r(l, sigma);
+              return with_integers(bits, r);
+            }
+          case problem::cycle:
+            if (by_class) {
+              strip_run<cycle_classes_algo> r(l, sigma);
+              return with_integers(bits, r);
+            } else {
+              strip_run<cycle_algo> r(l, sigma);
+              return with_integers(bits, r);
+            }
+        }
+        return 0;
+      }
+      g = l.graph;
+      order = l.order;
+      classes.resize(num_edges(g));
+      for (auto e : as_range(edges(g))) {
+        classes[get(boost::edge_index, g, e)] = lattice::edge_class(l,
+          get(boost::vertex_index, g, source(e, g)),
+          get(boost::vertex_index, g, target(e, g)));
+      }
     } else {
-      std::cin >> s;
+      auto format = graph_format::automatic;
+      if (vm.count("format"))
+        format = parse_graph_format(vm["format"].as<std::string>());
+      std::string filename;
+      if (vm.count("input-file"))
+        filename = vm["input-file"].as<std::string>();
+      g = read_graph(filename, format, &classes, &format);
+      if (format == graph_format::dimacs)
+        first_vertex = 1;
+    }
+    for (auto c : classes) {
+      if (by_class and c >= mpolynomial<int>::num_variables)
+        throw std::runtime_error("at most 4 edge classes, numbered from 0");
     }
-    g = parse_graph(s);
   } catch (std::exception& e) {
     std::cerr << "error: " << e.what() << "\n";
     return 1;
@@ -137,43 +804,61 @@ int main (int argc, char *argv[])
   std::cerr << "Graph with " << num_vertices(g) << " vertices and "
             << num_edges(g) << " edges.\n";
 
-  // check for connectedness
-  auto component = boost::make_vector_property_map<int>(
-    get(boost::vertex_index, g));
-  auto num = connected_components(g, component);
-  if (num > 1) {
+  if (not is_connected(g)) {
     std::cerr << "The input graph is not connected. A connected input is required\n";
     return 1;
   }
 
-  std::vector<unsigned int> order(num_vertices(g));
+  tree_decomposition::tree_decomposition td;
 
-  if (vm.count("fill-in")) {
-    heuristics::greedy_fillin_order(g, order.begin());
-  } else if (vm.count("local-degree")) {
-    heuristics::greedy_local_degree_order(g, order.begin());
-  } else if (vm.count("local-fill-in")) {
-    heuristics::greedy_local_fillin_order(g, order.begin());
-  } else if (vm.count("elimination-order")) {
-    // parse the std::string
-    std::string s = vm["elimination-order"].as<std::string>();
-    parse_elimination_order(s, order.begin());
-    if (not validate_elimination_order(order, g)) {
-      std::cerr << "error: elimination order not valid\n";
+  if (vm.count("load-tree")) {
+    try {
+      td = tree_decomposition::load(vm["load-tree"].as<std::string>(), g);
+    } catch (std::exception& e) {
+      std::cerr << "error: " << e.what() << "\n";
       return 1;
     }
-    std::cerr << "Vertex ordering: " << s << "\n";
+    order.clear();
   } else {
-    heuristics::greedy_degree_order(g, order.begin());
+    // lattices come with their natural column by column order
+    bool natural_order = not order.empty() and check == 0;
+    order.resize(num_vertices(g));
+
+    if (natural_order) {
+      std::cerr << "Using the natural lattice ordering\n";
+    } else if (vm.count("elimination-order")) {
+      // parse the std::string
+      std::string s = vm["elimination-order"].as<std::string>();
+      parse_elimination_order(s, order.begin());
+      if (not validate_elimination_order(order, g)) {
+        std::cerr << "error: elimination order not valid\n";
+        return 1;
+      }
+      std::cerr << "Vertex ordering: " << s << "\n";
+    } else {
+      heuristic_order(g, vm, order.begin());
+    }
+
+    td = tree_decomposition::build_tree_decomposition(order, g);
   }
 
-  auto td = tree_decomposition::build_tree_decomposition(order, g);
+  if (vm.count("save-tree")) {
+    try {
+      tree_decomposition::save(vm["save-tree"].as<std::string>(), td,
+                               num_vertices(g));
+    } catch (std::exception& e) {
+      std::cerr << "error: " << e.what() << "\n";
+      return 1;
+    }
+  }
 
   if (vm.count("print-tree") or vm.count("tree-only")) {
-    std::cerr << "Elimination order: ";
-    for (auto x : order)
-      std::cerr << x << " ";
-    std::cerr << "\n";
+    if (not order.empty()) {
+      std::cerr << "Elimination order: ";
+      for (auto x : order)
+        std::cerr << x << " ";
+      std::cerr << "\n";
+    }
 
     std::cerr << "Tree decomposition: " << td << "\n"
               << "Tree decomposition width: "
@@ -183,11 +868,23 @@ int main (int argc, char *argv[])
   if (vm.count("tree-only"))
     return 0;
 
-  if (vm.count("chinese-remainder")) {
-    chinese_remainder::chinese_remainder<algo>(td);
-  } else {
-    using gmp::mpz_int;
-    auto result = transfer::transfer(algo<mpz_int>(), td);
-    std::cout << result << "\n";
+  int status;
+  try {
+    tree_decomposition::flat_tree flat(td);
+
+    if (vm.count("estimate")) {
+      std::cout << estimate::estimate(flat, weight_size(vm));
+      return 0;
+    }
+
+    if (vm.count("sample") or vm.count("witness"))
+      return sample_paths(flat, vm, which, bits, first_vertex, std::cout);
+    status = count(g, classes, flat, vm, which, bits, std::cout);
+  } catch (std::exception& e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
   }
+  if (status == 0)
+    std::cout << "\n";
+  return status;
 }
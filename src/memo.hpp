@@ -0,0 +1,171 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef MEMO_HPP
+#define MEMO_HPP
+
+#include "tree_decomposition/flat_tree.hpp"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+ *  The table of a subtree only depends on its structure as seen from the
+ *  positions of its bags: the size of each bag, its edges and their
+ *  classes as pairs of positions, where the vertices of each child go in
+ *  the parent (or that they are deleted), and the exhausted vertices when
+ *  pruning. Vertex labels do not matter, so two subtrees with the same
+ *  structure give the same table.
+ *
+ *  The positions are compared as they are, not up to a permutation: two
+ *  subtrees that differ only in the order of the vertices of a bag have
+ *  different ids and are both computed. Matching them would need a
+ *  canonical order of the positions and relabelling the states of the
+ *  stored table into it.
+ *
+ *  Each structure gets an id, computed bottom up from the ids of the
+ *  children. Before the transfer, a dry run over the ids finds which
+ *  subtrees will be skipped, and how many times each stored table will be
+ *  used: a table is kept only if used again, and moved out at its last
+ *  use.
+ */
+
+namespace memo {
+  using tree_decomposition::flat_tree;
+  typedef unsigned int uint;
+
+  template<class Table>
+  class cache {
+  public:
+    cache(flat_tree const& t, bool with_exhausted)
+      : id_(t.size()), starts_(t.size()), num_reused_(0)
+    {
+      // the structure ids, and where each subtree starts in post-order
+      std::map<std::vector<uint>, uint> ids;
+      std::vector<uint> occurrences;
+      std::vector<uint> stack, first(t.size());
+      for (uint b = 0; b < t.size(); ++b) {
+        std::vector<uint> key{ uint(t.bag_size(b)), t[b].num_children };
+        first[b] = b;
+        auto const first_child = stack.size() - t[b].num_children;
+        for (auto k = first_child; k < stack.size(); ++k) {
+          auto const c = stack[k];
+          if (k == first_child)
+            first[b] = first[c];
+          key.push_back(id_[c]);
+          for (auto v : t.vertices(c))
+            key.push_back(t.has(b, v) ? t.index(b, v) : uint(-1));
+        }
+        stack.erase(stack.begin() + first_child, stack.end());
+        stack.push_back(b);
+
+        key.push_back(t[b].edge_end - t[b].edge_begin);
+        for (auto k = t[b].edge_begin; k < t[b].edge_end; ++k) {
+          key.push_back(t.index(b, t.edge(k).first));
+          key.push_back(t.index(b, t.edge(k).second));
+          key.push_back(t.edge_class(k));
+        }
+        if (with_exhausted) {
+          for (auto x : t.exhausted(b))
+            key.push_back(x);
+        }
+
+        auto i = ids.insert(std::make_pair(key, ids.size())).first;
+        id_[b] = i->second;
+        occurrences.resize(ids.size());
+        ++ occurrences[id_[b]];
+      }
+
+      // the subtrees starting at each bag, largest first
+      for (uint b = t.size(); b-- > 0; )
+        starts_[first[b]].push_back(b);
+
+      // dry run: a structure seen again is stored the first time
+      uses_.resize(ids.size());
+      std::vector<char> stored(ids.size());
+      for (uint b = 0; b < t.size(); ++b) {
+        uint a;
+        if (find(b, stored, a)) {
+          ++ uses_[id_[a]];
+          b = a;
+        } else if (occurrences[id_[b]] > 1) {
+          stored[id_[b]] = true;
+        }
+      }
+    }
+
+    // the largest subtree starting at bag b with a stored table, its root
+    // in a and its table in table
+    bool lookup(uint b, uint& a, Table& table)
+    {
+      auto i = tables_.end();
+      for (auto x : starts_[b]) {
+        i = tables_.find(id_[x]);
+        if (i != tables_.end()) {
+          a = x;
+          break;
+        }
+      }
+      if (i == tables_.end())
+        return false;
+
+      ++ num_reused_;
+      if (--i->second.first == 0) {
+        table = std::move(i->second.second);
+        tables_.erase(i);
+      } else {
+        table = i->second.second;
+      }
+      return true;
+    }
+
+    // the table of the subtree of bag b, kept if it will be used again
+    void store(uint b, Table const& table)
+    {
+      auto const id = id_[b];
+      if (uses_[id] > 0 and tables_.count(id) == 0)
+        tables_.insert(std::make_pair(id, std::make_pair(uses_[id], table)));
+    }
+
+    // how many subtrees have been skipped so far
+    std::size_t num_reused() const { return num_reused_; }
+
+  private:
+    template<class Stored>
+    bool find(uint b, Stored const& stored, uint& a) const
+    {
+      for (auto x : starts_[b]) {
+        if (stored[id_[x]]) {
+          a = x;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    std::vector<uint> id_;
+    std::vector<std::vector<uint> > starts_;
+    std::vector<uint> uses_;
+    // the tables stored, with the number of uses left
+    std::map<uint, std::pair<uint, Table> > tables_;
+    std::size_t num_reused_;
+  };
+}
+
+#endif
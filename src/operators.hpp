@@ -0,0 +1,95 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef OPERATORS_HPP
+#define OPERATORS_HPP
+
+#include "profile.hpp"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ *  The operator set concept, what the transfer needs from a counting
+ *  problem. A table maps the states of a bag (one entry per vertex, in
+ *  order) to their weights, and an operator set Ops provides
+ *
+ *    Ops::weight_type, Ops::state_type, Ops::table_type
+ *
+ *    op.empty_state(n)            the table of n unused vertices
+ *    op.join_operator(i, j, t, c) add the edge of class c between
+ *                                 positions i and j
+ *    op.delete_operator(i, t)     forget the vertex at position i
+ *    op.table_fusion(A_to_B, a, b, counter)
+ *                                 combine the tables of two subtrees,
+ *                                 position i of a being A_to_B[i] in b
+ *    op.prune, op.prune_operator(exhausted, t)
+ *                                 whether and how to drop the states
+ *                                 that cannot be completed, given which
+ *                                 vertices have no edges left
+ *    op.reduce, op.reduce_operator(t)
+ *                                 whether and how to keep only some of
+ *                                 the states, giving the same result
+ *    op.finish(t)                 the result, once every vertex has
+ *                                 been deleted
+ *
+ *  operators::check<Ops> fails to compile, with a message saying what
+ *  is wrong, if Ops does not model the concept.
+ */
+
+namespace operators {
+  template<class Ops>
+  struct check {
+    typedef typename Ops::weight_type weight;
+    typedef typename Ops::state_type state;
+    typedef typename Ops::table_type table;
+
+    static Ops const& op();
+    static table const& t();
+    static profile::null_counter& counter();
+
+    static_assert(std::is_same<typename table::key_type, state>::value,
+      "table_type must be keyed by state_type");
+    static_assert(std::is_same<typename table::mapped_type, weight>::value,
+      "table_type must map states to weight_type");
+    static_assert(std::is_same<decltype(op().empty_state(std::size_t())), table>::value,
+      "empty_state(n) must return a table");
+    static_assert(std::is_same<decltype(op().join_operator(std::size_t(), std::size_t(), t(), 0u)), table>::value,
+      "join_operator(i, j, table, class) must return a table");
+    static_assert(std::is_same<decltype(op().delete_operator(std::size_t(), t())), table>::value,
+      "delete_operator(i, table) must return a table");
+    static_assert(std::is_same<decltype(op().table_fusion(std::vector<unsigned int>(), t(), t(), counter())), table>::value,
+      "table_fusion(A_to_B, table, table, counter) must return a table");
+    static_assert(std::is_convertible<decltype(op().prune), bool>::value,
+      "prune must say whether to call prune_operator");
+    static_assert(std::is_same<decltype(op().prune_operator(std::vector<char>(), t())), table>::value,
+      "prune_operator(exhausted, table) must return a table");
+    static_assert(std::is_convertible<decltype(op().reduce), bool>::value,
+      "reduce must say whether to call reduce_operator");
+    static_assert(std::is_same<decltype(op().reduce_operator(t())), table>::value,
+      "reduce_operator(table) must return a table");
+    static_assert(std::is_same<decltype(op().finish(t())), weight>::value,
+      "finish(table) must return a weight");
+
+    static const bool value = true;
+  };
+}
+
+#endif
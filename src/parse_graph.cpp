@@ -11,56 +11,398 @@
  *
  */
 
-#include "graph_type.hpp"
+#include "parse_graph.hpp"
 
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/properties.hpp>
 #include <boost/iterator/counting_iterator.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <stdexcept>
 #include <vector>
 
-graph_type parse_graph(std::string const& s)
-{
-  using namespace std;
-  using namespace boost;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  /*
+   *  the whole input in memory: files are mapped, stdin is read in
+   *  large chunks
+   */
+  class input_buffer {
+    const char* data_;
+    std::size_t size_;
+    void* map_;
+    std::vector<char> copy_;
+
+    input_buffer(input_buffer const&);
+    input_buffer& operator=(input_buffer const&);
+
+  public:
+    explicit input_buffer(std::string const& filename)
+      : data_(nullptr), size_(0), map_(MAP_FAILED)
+    {
+      if (filename.empty()) {
+        read_all(stdin);
+        return;
+      }
+
+      int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error("file " + filename + " not found");
+
+      struct stat st;
+      if (::fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0) {
+        map_ = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_ != MAP_FAILED) {
+          ::madvise(map_, st.st_size, MADV_SEQUENTIAL);
+          data_ = static_cast<const char*>(map_);
+          size_ = st.st_size;
+        }
+      }
+      ::close(fd);
+
+      // pipes, empty files or a failed mmap
+      if (map_ == MAP_FAILED) {
+        std::FILE* f = std::fopen(filename.c_str(), "rb");
+        if (not f)
+          throw std::runtime_error("file " + filename + " not found");
+        read_all(f);
+        std::fclose(f);
+      }
+    }
+
+    ~input_buffer()
+    {
+      if (map_ != MAP_FAILED)
+        ::munmap(map_, size_);
+    }
+
+    const char* begin() const { return data_; }
+    const char* end()   const { return data_ + size_; }
+
+  private:
+    void read_all(std::FILE* f)
+    {
+      const std::size_t chunk = 1 << 20;
+      std::size_t n = 0;
+      do {
+        copy_.resize(size_ + chunk);
+        n = std::fread(copy_.data() + size_, 1, chunk, f);
+        size_ += n;
+      } while (n == chunk);
+      copy_.resize(size_);
+      data_ = copy_.data();
+    }
+  };
+
+  /*
+   *  a cursor over the input keeping track of line and column for
+   *  error messages
+   */
+  class scanner {
+    const char* p_;
+    const char* end_;
+    const char* line_start_;
+    unsigned int line_;
+    std::string name_;
+
+  public:
+    scanner(const char* begin, const char* end, std::string const& name)
+      : p_(begin), end_(end), line_start_(begin), line_(1), name_(name)
+    { }
+
+    bool eof() const { return p_ == end_; }
+    char peek() const { return eof() ? '\0' : *p_; }
+
+    bool at_eol() const
+    {
+      return eof() or *p_ == '\n' or *p_ == '\r';
+    }
 
-  vector<pair<int, int> > edge_list;
+    void advance()
+    {
+      if (*p_++ == '\n') {
+        ++ line_;
+        line_start_ = p_;
+      }
+    }
 
-  string parse_err_msg = "parse error";
-  istringstream iss(s);
+    // spaces and tabs
+    void skip_blanks()
+    {
+      while (not eof() and (*p_ == ' ' or *p_ == '\t'))
+        ++ p_;
+    }
 
-  if (!iss.good())
-    throw runtime_error(parse_err_msg + " 1");
+    // any whitespace, newlines included
+    void skip_space()
+    {
+      while (not eof() and std::isspace(static_cast<unsigned char>(*p_)))
+        advance();
+    }
 
-  unsigned int n = 0;
-  while (true) {
-    unsigned int a = 0, b = 0;
+    void skip_line()
+    {
+      while (not eof() and *p_ != '\n')
+        ++ p_;
+      if (not eof())
+        advance();
+    }
 
-    iss >> a;
-    n = max(n, a);
+    void expect(char c)
+    {
+      if (peek() != c)
+        throw error(std::string("expecting '") + c + "'");
+      advance();
+    }
 
-    if (iss.get() !=  '-' or iss.bad())
-      throw runtime_error("expecting a dash!");
-    if (iss.get() !=  '-' or iss.bad())
-      throw runtime_error("expecting a dash!");
+    void expect_eol()
+    {
+      skip_blanks();
+      if (not at_eol())
+        throw error("expecting end of line");
+      skip_line();
+    }
 
-    iss >> b;
-    n = max(n, b);
+    unsigned int read_uint()
+    {
+      if (eof() or not std::isdigit(static_cast<unsigned char>(*p_)))
+        throw error("expecting a number");
+      unsigned long n = 0;
+      while (not eof() and std::isdigit(static_cast<unsigned char>(*p_))) {
+        n = n * 10 + (*p_++ - '0');
+        if (n > std::numeric_limits<unsigned int>::max())
+          throw error("number too large");
+      }
+      return n;
+    }
 
-    edge_list.push_back(make_pair(a, b));
+    // characters left in the input
+    std::size_t left() const { return end_ - p_; }
 
-    if (iss.eof())
-      break;
+    std::string read_word()
+    {
+      auto start = p_;
+      while (not eof() and not std::isspace(static_cast<unsigned char>(*p_)))
+        ++ p_;
+      return std::string(start, p_);
+    }
 
-    if (iss.get() !=  ',' or iss.bad())
-      throw runtime_error("expecting a comma!");
+    std::runtime_error error(std::string const& msg) const
+    {
+      std::ostringstream oss;
+      if (not name_.empty())
+        oss << name_ << ":";
+      oss << line_ << ":" << (p_ - line_start_ + 1) << ": " << msg;
+      return std::runtime_error(oss.str());
+    }
+  };
+
+  typedef std::vector<std::pair<unsigned int, unsigned int> > edge_vector;
+  typedef std::vector<unsigned int> class_vector;
+
+  // a 0-based vertex, one less than the largest number so that the
+  // number of vertices is one too
+  unsigned int read_vertex(scanner& s)
+  {
+    auto v = s.read_uint();
+    if (v == std::numeric_limits<unsigned int>::max())
+      throw s.error("vertex out of range");
+    return v;
+  }
+
+  // an optional edge class after the endpoints, 0 if missing
+  unsigned int read_class(scanner& s)
+  {
+    s.skip_blanks();
+    if (s.at_eol() or s.peek() == ',')
+      return 0;
+    return s.read_uint();
+  }
+
+  // 0--1,1--2,2--0 or, with edge classes, 0--1:0,1--2:1,2--0:1
+  unsigned int parse_edges(scanner& s, edge_vector& edges, class_vector& classes)
+  {
+    unsigned int n = 0;
+    s.skip_space();
+    if (s.eof())
+      throw s.error("empty input");
+    // an edge after each comma, none after the last
+    for (;;) {
+      auto a = read_vertex(s);
+      s.skip_space();
+      s.expect('-');
+      s.expect('-');
+      s.skip_space();
+      auto b = read_vertex(s);
+      n = std::max(n, std::max(a, b) + 1);
+      edges.emplace_back(a, b);
+      s.skip_space();
+      if (s.peek() == ':') {
+        s.advance();
+        s.skip_space();
+        classes.push_back(s.read_uint());
+        s.skip_space();
+      } else {
+        classes.push_back(0);
+      }
+      if (s.eof())
+        break;
+      s.expect(',');
+      s.skip_space();
+    }
+    return n;
+  }
+
+  // one 0-based pair per line, optionally followed by the edge class
+  unsigned int parse_edge_list(scanner& s, edge_vector& edges, class_vector& classes)
+  {
+    unsigned int n = 0;
+    while (not s.eof()) {
+      s.skip_blanks();
+      if (s.at_eol() or s.peek() == '#' or s.peek() == '%') {
+        s.skip_line();
+        continue;
+      }
+      auto a = read_vertex(s);
+      s.skip_blanks();
+      auto b = read_vertex(s);
+      classes.push_back(read_class(s));
+      s.expect_eol();
+      n = std::max(n, std::max(a, b) + 1);
+      edges.emplace_back(a, b);
+    }
+    return n;
+  }
+
+  // DIMACS and PACE .gr, 1-based, an edge class may follow the endpoints
+  unsigned int parse_dimacs(scanner& s, edge_vector& edges, class_vector& classes)
+  {
+    unsigned int n = 0;
+    bool header = false;
+    while (not s.eof()) {
+      s.skip_blanks();
+      if (s.at_eol() or s.peek() == 'c') {
+        s.skip_line();
+        continue;
+      }
+      if (s.peek() == 'p') {
+        if (header)
+          throw s.error("duplicate problem line");
+        s.advance();
+        s.skip_blanks();
+        s.read_word();
+        s.skip_blanks();
+        n = s.read_uint();
+        s.skip_blanks();
+        // an edge takes at least four characters, "1 2" and a newline
+        auto const m = s.read_uint();
+        if (m > (s.left() + 1) / 4)
+          throw s.error("more edges than the input holds");
+        edges.reserve(m);
+        s.expect_eol();
+        header = true;
+        continue;
+      }
+      if (s.peek() == 'e') {
+        s.advance();
+        s.skip_blanks();
+      }
+      auto a = s.read_uint();
+      s.skip_blanks();
+      auto b = s.read_uint();
+      if (a == 0 or b == 0 or (header and (a > n or b > n)))
+        throw s.error("vertex out of range");
+      classes.push_back(read_class(s));
+      s.expect_eol();
+      if (not header)
+        n = std::max(n, std::max(a, b));
+      edges.emplace_back(a - 1, b - 1);
+    }
+    return n;
   }
 
+  graph_format detect_format(const char* begin, const char* end)
+  {
+    auto p = begin;
+    while (p != end and std::isspace(static_cast<unsigned char>(*p)))
+      ++ p;
+    if (p != end and (*p == 'c' or *p == 'p'))
+      return graph_format::dimacs;
+    for (; p != end and *p != '\n'; ++p)
+      if (*p == '-')
+        return graph_format::edges;
+    return graph_format::edge_list;
+  }
+
+  graph_type parse(const char* begin, const char* end,
+                   std::string const& name, graph_format format,
+                   class_vector* classes, graph_format* read_as = nullptr)
+  {
+    if (format == graph_format::automatic)
+      format = detect_format(begin, end);
+    if (read_as)
+      *read_as = format;
+
+    scanner s(begin, end, name);
+    edge_vector edge_list;
+    class_vector edge_classes;
+    unsigned int n = 0;
+
+    switch (format) {
+      case graph_format::edges:
+        n = parse_edges(s, edge_list, edge_classes);
+        break;
+      case graph_format::edge_list:
+        n = parse_edge_list(s, edge_list, edge_classes);
+        break;
+      default:
+        n = parse_dimacs(s, edge_list, edge_classes);
+    }
+
+    if (edge_list.empty())
+      throw s.error("no edges found");
+
+    if (classes)
+      classes->swap(edge_classes);
+
+    return make_graph(edge_list, n);
+  }
+
+  bool has_extension(std::string const& s, std::string const& ext)
+  {
+    return s.size() >= ext.size() and
+      s.compare(s.size() - ext.size(), ext.size(), ext) == 0;
+  }
+}
+
+graph_format parse_graph_format(std::string const& s)
+{
+  if (s == "auto")
+    return graph_format::automatic;
+  if (s == "edges")
+    return graph_format::edges;
+  if (s == "edge-list")
+    return graph_format::edge_list;
+  if (s == "dimacs" or s == "gr")
+    return graph_format::dimacs;
+  throw std::runtime_error("unknown input format " + s);
+}
+
+graph_type make_graph(edge_vector const& edge_list, unsigned int n)
+{
+  using namespace boost;
+
   boost::counting_iterator<int> ep_iter(0);
-  graph_type g(edge_list.begin(), edge_list.end(), ep_iter, n + 1);
+  graph_type g(edge_list.begin(), edge_list.end(), ep_iter, n);
 
   unsigned int i = 0;
   graph_type::vertex_iterator vi, vi_end;
@@ -69,3 +411,88 @@ graph_type parse_graph(std::string const& s)
 
   return g;
 }
+
+graph_type parse_graph(std::string const& s, graph_format format,
+                       std::vector<unsigned int>* classes)
+{
+  return parse(s.data(), s.data() + s.size(), "", format, classes);
+}
+
+graph_type read_graph(std::string const& filename, graph_format format,
+                      std::vector<unsigned int>* classes, graph_format* read_as)
+{
+  if (format == graph_format::automatic and
+      (has_extension(filename, ".gr") or has_extension(filename, ".col") or
+       has_extension(filename, ".dimacs")))
+    format = graph_format::dimacs;
+
+  input_buffer input(filename);
+  return parse(input.begin(), input.end(),
+               filename.empty() ? "<stdin>" : filename, format, classes, read_as);
+}
+
+td_file read_td(std::string const& filename)
+{
+  input_buffer input(filename);
+  scanner s(input.begin(), input.end(), filename);
+
+  td_file td;
+  td.num_vertices = 0;
+  bool header = false;
+
+  while (not s.eof()) {
+    s.skip_blanks();
+    if (s.at_eol() or s.peek() == 'c') {
+      s.skip_line();
+      continue;
+    }
+    if (s.peek() == 's') {
+      if (header)
+        throw s.error("duplicate solution line");
+      s.advance();
+      s.skip_blanks();
+      if (s.read_word() != "td")
+        throw s.error("expecting 'td'");
+      s.skip_blanks();
+      td.bags.resize(s.read_uint());
+      s.skip_blanks();
+      s.read_uint(); // the width + 1, recomputed anyway
+      s.skip_blanks();
+      td.num_vertices = s.read_uint();
+      s.expect_eol();
+      header = true;
+      continue;
+    }
+    if (not header)
+      throw s.error("expecting the solution line");
+    if (s.peek() == 'b') {
+      s.advance();
+      s.skip_blanks();
+      auto i = s.read_uint();
+      if (i == 0 or i > td.bags.size())
+        throw s.error("bag out of range");
+      auto& bag = td.bags[i - 1];
+      s.skip_blanks();
+      while (not s.at_eol()) {
+        auto v = s.read_uint();
+        if (v == 0 or v > td.num_vertices)
+          throw s.error("vertex out of range");
+        bag.push_back(v - 1);
+        s.skip_blanks();
+      }
+      s.skip_line();
+      continue;
+    }
+    auto a = s.read_uint();
+    s.skip_blanks();
+    auto b = s.read_uint();
+    if (a == 0 or b == 0 or a > td.bags.size() or b > td.bags.size())
+      throw s.error("bag out of range");
+    s.expect_eol();
+    td.edges.emplace_back(a - 1, b - 1);
+  }
+
+  if (not header)
+    throw s.error("missing solution line");
+  return td;
+}
@@ -20,8 +20,54 @@
 #define PARSE_GRAPH_HPP
 
 #include "graph_type.hpp"
+
 #include <string>
+#include <utility>
+#include <vector>
+
+/*
+ *  Supported input formats:
+ *
+ *  edges      0--1,1--2,2--0         (the original format, 0-based)
+ *  edge-list  one "a b" pair per line (0-based, '#' or '%' comments)
+ *  dimacs     DIMACS / PACE .gr      ('c' comments, "p <type> n m" header,
+ *                                    "e a b" or "a b" edges, 1-based)
+ *
+ *  Edges can carry a class, a small number used to count them separately:
+ *  "0--1:2" in the edges format, a third number on the line otherwise.
+ *
+ *  'automatic' picks dimacs for .gr/.col/.dimacs files and otherwise
+ *  looks at the first meaningful line of the input.
+ */
+enum class graph_format { automatic, edges, edge_list, dimacs };
+
+graph_format parse_graph_format(std::string const&);
+
+// build a graph on n vertices from a list of (0-based) edges
+graph_type make_graph(std::vector<std::pair<unsigned int, unsigned int> > const&,
+                      unsigned int n);
+
+// if classes is given, it receives the class of each edge by edge index
+graph_type parse_graph(std::string const&, graph_format = graph_format::edges,
+                       std::vector<unsigned int>* classes = nullptr);
+
+// read from a file (memory mapped) or, if the filename is empty, from stdin;
+// if read_as is given, it receives the format the input was read in
+graph_type read_graph(std::string const& filename,
+                      graph_format = graph_format::automatic,
+                      std::vector<unsigned int>* classes = nullptr,
+                      graph_format* read_as = nullptr);
+
+/*
+ *  A PACE .td file: bags are lists of 0-based vertices, tree edges join
+ *  0-based bag indices.
+ */
+struct td_file {
+  unsigned int num_vertices;
+  std::vector<std::vector<unsigned int> > bags;
+  std::vector<std::pair<unsigned int, unsigned int> > edges;
+};
 
-graph_type parse_graph(std::string const&);
+td_file read_td(std::string const& filename);
 
 #endif
@@ -0,0 +1,196 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// mallinfo2 is in glibc 2.33 and later, elsewhere the live heap is not
+// measured
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define PROFILE_LIVE_HEAP 1
+#include <malloc.h>
+#else
+#define PROFILE_LIVE_HEAP 0
+#endif
+
+/*
+ *  Instrumentation of the transfer. The transfer is templated on the
+ *  profiler: with null_profiler every hook is an empty inline function
+ *  and the instrumented code compiles to the plain one.
+ *
+ *  trace_profiler records, for each bag and each operator applied to
+ *  it, the number of states in and out, the wall time, the change in
+ *  the bytes live on the heap (as reported by malloc, when it can tell:
+ *  what stays allocated, not what was allocated on the way) and, for
+ *  table_fusion, how many pairs of states were examined and how many
+ *  produced a new state. It writes them as a Chrome trace
+ *  (chrome://tracing, Perfetto), which is plain JSON.
+ */
+
+namespace profile {
+  // passed to table_fusion to count pairs of states
+  struct null_counter {
+    void examined() { }
+    void accepted() { }
+  };
+
+  struct pair_counter {
+    std::size_t num_examined = 0;
+    std::size_t num_accepted = 0;
+
+    void examined() { ++ num_examined; }
+    void accepted() { ++ num_accepted; }
+  };
+
+  struct null_profiler {
+    typedef null_counter counter_type;
+
+    counter_type& counter() { return counter_; }
+
+    void begin_bag(unsigned int, std::size_t) { }
+    void end_bag(unsigned int, std::size_t) { }
+
+    template<class F>
+    auto record(const char*, unsigned int, std::size_t, F f) -> decltype(f())
+    {
+      return f();
+    }
+
+  private:
+    counter_type counter_;
+  };
+
+  class trace_profiler {
+  public:
+    typedef pair_counter counter_type;
+
+    trace_profiler() : start_(clock::now()) { }
+
+    counter_type& counter() { return counter_; }
+
+    void begin_bag(unsigned int, std::size_t size)
+    {
+      bag_start_ = now();
+      bag_heap_ = live_heap();
+      bag_size_ = size;
+    }
+
+    void end_bag(unsigned int bag, std::size_t states)
+    {
+      event e;
+      e.name = "bag";
+      e.bag = bag;
+      e.start = bag_start_;
+      e.duration = now() - bag_start_;
+      e.states_in = bag_size_;  // the number of vertices for bags
+      e.states_out = states;
+      e.live_heap_delta = live_heap() - bag_heap_;
+      e.examined = e.accepted = 0;
+      events_.push_back(e);
+    }
+
+    template<class F>
+    auto record(const char* name, unsigned int bag, std::size_t states_in, F f)
+      -> decltype(f())
+    {
+      counter_ = counter_type();
+      event e;
+      e.name = name;
+      e.bag = bag;
+      e.states_in = states_in;
+      auto heap_before = live_heap();
+      e.start = now();
+      auto result = f();
+      e.duration = now() - e.start;
+      e.live_heap_delta = live_heap() - heap_before;
+      e.states_out = result.size();
+      e.examined = counter_.num_examined;
+      e.accepted = counter_.num_accepted;
+      events_.push_back(e);
+      return result;
+    }
+
+    void write(std::ostream& o) const
+    {
+      o << "{\"traceEvents\":[\n";
+      for (std::size_t i = 0; i < events_.size(); ++i) {
+        auto const& e = events_[i];
+        bool bag = e.name == std::string("bag");
+        o << "{\"name\":\"" << e.name << "\",\"cat\":\"transfer\",\"ph\":\"X\""
+          << ",\"ts\":" << e.start << ",\"dur\":" << e.duration
+          << ",\"pid\":1,\"tid\":1,\"args\":{\"bag\":" << e.bag;
+        if (bag) {
+          o << ",\"size\":" << e.states_in;
+        } else {
+          o << ",\"states_in\":" << e.states_in;
+        }
+        o << ",\"states_out\":" << e.states_out;
+        if (PROFILE_LIVE_HEAP)
+          o << ",\"live_heap_delta\":" << e.live_heap_delta;
+        if (e.examined > 0)
+          o << ",\"pairs_examined\":" << e.examined
+            << ",\"pairs_accepted\":" << e.accepted;
+        o << "}}" << (i + 1 < events_.size() ? ",\n" : "\n");
+      }
+      o << "],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+  private:
+    typedef std::chrono::steady_clock clock;
+
+    struct event {
+      const char* name;
+      unsigned int bag;
+      double start, duration;  // microseconds
+      std::size_t states_in, states_out;
+      long long live_heap_delta;
+      std::size_t examined, accepted;
+    };
+
+    double now() const
+    {
+      return std::chrono::duration<double, std::micro>(clock::now() - start_).count();
+    }
+
+    static long long live_heap()
+    {
+#if PROFILE_LIVE_HEAP
+      auto m = ::mallinfo2();
+      return m.uordblks + m.hblkhd;
+#else
+      return 0;
+#endif
+    }
+
+    clock::time_point start_;
+    counter_type counter_;
+    std::vector<event> events_;
+    double bag_start_ = 0;
+    long long bag_heap_ = 0;
+    std::size_t bag_size_ = 0;
+  };
+}
+
+#endif
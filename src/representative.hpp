@@ -0,0 +1,206 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef REPRESENTATIVE_HPP
+#define REPRESENTATIVE_HPP
+
+#include "connectivity.hpp"
+#include "utility/semiring.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ *  The rank based reduction of Bodlaender, Cygan, Kratsch and Nederlof,
+ *  for the tables of connectivity states with max-plus weights.
+ *
+ *  Two states with the same vertices unused, inside a strand and at a
+ *  strand end, and with as many strands ending outside the bag, only
+ *  differ in how they pair the strand ends U. A completion of either, the
+ *  edges still to come, gives a single path or cycle exactly when joined
+ *  with the pairing it connects U into one block. A set of states that
+ *  has, for every completion, one as heavy as the heaviest of the table
+ *  it can be joined with gives the same result: this is a representative
+ *  set. One is given by the rows of
+ *
+ *    C[p][cut] = 1 if every strand of p is on one side of cut
+ *
+ *  over GF(2), with the cuts of U in two sides, the first end always on
+ *  the first side. Going through the states from the heaviest, keeping
+ *  those whose row is independent of the rows kept so far, leaves at most
+ *  2^(|U| - 1) states of each kind, whatever the number of pairings.
+ */
+
+namespace representative {
+  using connectivity = connectivity_states::connectivity;
+
+  // beyond this many strand ends, the 2^(max_ends - 1) columns are too
+  // many and all the states are kept
+  const std::size_t max_ends = 16;
+
+  // the vertices inside a strand (-1), at a strand end (1) or unused, and
+  // the number of strands with a single end in the bag
+  typedef std::pair<connectivity, unsigned int> kind;
+
+  inline kind kind_of(connectivity const& c)
+  {
+    unsigned int count[connectivity_states::max_labels] = { };
+    kind k(c, 0);
+    for (auto& x : k.first) {
+      if (x > 0) {
+        ++ count[x];
+        x = 1;
+      }
+    }
+    for (auto n : count)
+      k.second += n == 1;
+    return k;
+  }
+
+  // the row of c, whose strand ends are at the positions in ends
+  inline std::vector<uint64_t>
+  cut_row(connectivity const& c, std::vector<std::size_t> const& ends)
+  {
+    auto const m = ends.size();
+    std::size_t const columns = std::size_t(1) << (m - 1);
+
+    // the ends of each strand as the bits of a cut, end k > 0 being on
+    // the side given by bit k - 1 and the first end always on side 0, so
+    // that its strand stays there
+    std::vector<std::size_t> strands;
+    for (std::size_t k = 1; k < m; ++k) {
+      if (c[ends[k]] == c[ends[0]])
+        continue;
+      bool seen = false;
+      for (std::size_t l = 1; l < k and not seen; ++l)
+        seen = c[ends[l]] == c[ends[k]];
+      if (seen)
+        continue;
+      std::size_t bits = 0;
+      for (std::size_t l = k; l < m; ++l) {
+        if (c[ends[l]] == c[ends[k]])
+          bits |= std::size_t(1) << (l - 1);
+      }
+      strands.push_back(bits);
+    }
+
+    // the cuts putting each strand on one side, one per subset of strands
+    std::vector<uint64_t> row((columns + 63) / 64);
+    for (std::size_t subset = 0; subset < (std::size_t(1) << strands.size()); ++subset) {
+      std::size_t cut = 0;
+      for (std::size_t s = 0; s < strands.size(); ++s) {
+        if ((subset >> s) & 1)
+          cut |= strands[s];
+      }
+      row[cut / 64] |= uint64_t(1) << (cut % 64);
+    }
+    return row;
+  }
+
+  // the first column set in row, or row.size() * 64 if none
+  inline std::size_t first_column(std::vector<uint64_t> const& row)
+  {
+    for (std::size_t w = 0; w < row.size(); ++w) {
+      if (row[w] == 0)
+        continue;
+      std::size_t b = 0;
+      while (((row[w] >> b) & 1) == 0)
+        ++ b;
+      return w * 64 + b;
+    }
+    return row.size() * 64;
+  }
+
+  // a representative set of the states of table
+  template<class Table>
+  typename std::enable_if<std::is_same<typename Table::mapped_type, max_plus>::value, Table>::type
+  reduce(Table const& table)
+  {
+    struct entry {
+      kind k;
+      typename Table::value_type const* state;
+    };
+    std::vector<entry> entries;
+    entries.reserve(table.size());
+    for (auto const& state : table)
+      entries.push_back(entry{ kind_of(state.first), &state });
+
+    // by kind, the heaviest first
+    std::sort(entries.begin(), entries.end(), [](entry const& a, entry const& b) {
+      if (a.k != b.k)
+        return a.k < b.k;
+      if (a.state->second != b.state->second)
+        return b.state->second < a.state->second;
+      return a.state->first < b.state->first;
+    });
+
+    Table reduced;
+    for (auto first = entries.begin(); first != entries.end(); ) {
+      auto last = first;
+      while (last != entries.end() and last->k == first->k)
+        ++ last;
+
+      std::vector<std::size_t> ends;
+      for (std::size_t i = 0; i < first->k.first.size(); ++i) {
+        if (first->k.first[i] == 1)
+          ends.push_back(i);
+      }
+
+      if (last - first == 1 or ends.empty() or ends.size() > max_ends) {
+        for (; first != last; ++first)
+          reduced[first->state->first] += first->state->second;
+        continue;
+      }
+
+      // Gaussian elimination, each row kept has its first column as pivot
+      std::vector<std::vector<uint64_t> > basis;
+      std::vector<std::size_t> pivot(std::size_t(1) << (ends.size() - 1), basis.max_size());
+      for (; first != last; ++first) {
+        auto row = cut_row(first->state->first, ends);
+        auto p = first_column(row);
+        while (p < pivot.size() and pivot[p] != basis.max_size()) {
+          auto const& b = basis[pivot[p]];
+          for (std::size_t w = 0; w < row.size(); ++w)
+            row[w] ^= b[w];
+          p = first_column(row);
+        }
+        if (p < pivot.size()) {
+          pivot[p] = basis.size();
+          basis.push_back(std::move(row));
+          reduced[first->state->first] += first->state->second;
+        }
+      }
+    }
+    return reduced;
+  }
+
+  // only max-plus weights are ordered
+  template<class Table>
+  typename std::enable_if<not std::is_same<typename Table::mapped_type, max_plus>::value, Table>::type
+  reduce(Table const&)
+  {
+    throw std::runtime_error("the rank based reduction needs max-plus weights");
+  }
+}
+
+#endif
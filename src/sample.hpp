@@ -0,0 +1,480 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SAMPLE_HPP
+#define SAMPLE_HPP
+
+#include "connectivity.hpp"
+#include "profile.hpp"
+#include "transfer.hpp"
+#include "tree_decomposition/flat_tree.hpp"
+
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+ *  Longest paths drawn uniformly at random, or one of them as a witness,
+ *  by tracing the transfer back from the root. With the weights of
+ *  longest_count (see semiring.hpp) the weight of a state is the longest
+ *  length of the partial paths giving it, and their number. Each step of
+ *  the transfer reaches a state of its table through transitions from its
+ *  input (a state, and whether a join takes its edge, or a pair of states
+ *  for a fusion) whose weights add up to that of the state. Drawing one
+ *  of the longest, with probability proportional to its count, gives the
+ *  state in the input, and so on down to the leaves: the edges taken by
+ *  the joins on the way make a path, each longest path being drawn with
+ *  the same probability.
+ *
+ *  The tables are not kept from a first transfer. The traceback of a
+ *  subtree computes it again, keeping only the tables of the children of
+ *  the bags on its heavy path (going down through the child with the
+ *  largest subtree), and goes down that path before doing the same with
+ *  the subtrees hanging off it. A bag is computed again once for each of
+ *  these subtrees it is in, that is O(log n) times. All the samples go
+ *  down together, grouped by state.
+ */
+
+namespace sample {
+  using tree_decomposition::flat_tree;
+  using tree_decomposition::edge_list;
+  using connectivity = connectivity_states::connectivity;
+
+  // a number drawn uniformly in [0, n), with n > 0, using only sums and
+  // comparisons: a random sum of the powers of two up to n, until below n
+  template<class Integer, class Rng>
+  Integer random_below(Integer const& n, Rng& rng)
+  {
+    std::vector<Integer> powers{ Integer(1u) };
+    while (not (n - powers.back() < powers.back()))
+      powers.push_back(powers.back() + powers.back());
+
+    for (;;) {
+      Integer r(0u);
+      uint64_t bits = 0;
+      for (std::size_t k = 0; k < powers.size(); ++k) {
+        if (k % 64 == 0)
+          bits = rng();
+        if ((bits >> (k % 64)) & 1)
+          r += powers[k];
+      }
+      if (r < n)
+        return r;
+    }
+  }
+
+  // the transitions drawn at random
+  template<class Rng>
+  struct uniform
+  {
+    Rng& rng;
+
+    explicit uniform(Rng& rng) : rng(rng) { }
+
+    template<class Integer>
+    Integer operator()(Integer const& n) const { return random_below(n, rng); }
+  };
+
+  // always the first of the longest transitions, for a witness
+  struct first
+  {
+    template<class Integer>
+    Integer operator()(Integer const&) const { return Integer(0u); }
+  };
+
+  /*
+   *  Draws, for each sample s, a transition leading to target[s]. The
+   *  transitions of a step are offered twice, in the same order: the first
+   *  time to add up the weight of each target, the second time to pick the
+   *  transition where the number drawn for a sample falls, with the counts
+   *  of the longest transitions laid end to end.
+   */
+  template<class Weight, class Transition>
+  class chooser
+  {
+    using integer_type = typename Weight::integer_type;
+
+    // the samples by target state
+    boost::unordered_map<connectivity, std::size_t> group_;
+    std::vector<Weight> total_;
+    // the numbers drawn and their samples, by increasing number
+    std::vector<std::vector<std::pair<integer_type, std::size_t> > > drawn_;
+    std::vector<integer_type> seen_;
+    std::vector<std::size_t> next_;
+    std::vector<Transition> chosen_;
+    bool drawing_;
+
+  public:
+    explicit chooser(std::vector<connectivity> const& target)
+      : chosen_(target.size()), drawing_(false)
+    {
+      for (std::size_t s = 0; s < target.size(); ++s) {
+        auto i = group_.insert(std::make_pair(target[s], drawn_.size())).first;
+        if (i->second == drawn_.size())
+          drawn_.emplace_back();
+        drawn_[i->second].push_back(std::make_pair(integer_type(), s));
+      }
+      total_.resize(drawn_.size());
+    }
+
+    void offer(connectivity const& c, Weight const& w, Transition const& t)
+    {
+      auto i = group_.find(c);
+      if (i == group_.end())
+        return;
+      auto const g = i->second;
+      if (not drawing_) {
+        total_[g] += w;
+        return;
+      }
+      auto& drawn = drawn_[g];
+      if (next_[g] == drawn.size() or not (w.length() == total_[g].length()))
+        return;
+      seen_[g] += w.count();
+      while (next_[g] < drawn.size() and drawn[next_[g]].first < seen_[g])
+        chosen_[drawn[next_[g]++].second] = t;
+    }
+
+    // after the first round of offers
+    template<class Draw>
+    void draw(Draw const& d)
+    {
+      for (std::size_t g = 0; g < drawn_.size(); ++g) {
+        for (auto& x : drawn_[g])
+          x.first = d(total_[g].count());
+        std::sort(drawn_[g].begin(), drawn_[g].end());
+      }
+      seen_.resize(drawn_.size());
+      next_.resize(drawn_.size());
+      drawing_ = true;
+    }
+
+    // after the second round of offers
+    std::vector<Transition> const& chosen() const
+    {
+      for (std::size_t g = 0; g < drawn_.size(); ++g)
+        assert(next_[g] == drawn_[g].size());
+      return chosen_;
+    }
+  };
+
+  template<class Operators, class Draw>
+  class traceback
+  {
+    using table_type = typename Operators::table_type;
+    using weight_type = typename Operators::weight_type;
+    using entry = typename table_type::value_type;
+
+    Operators const& op_;
+    flat_tree const& t_;
+    Draw const& draw_;
+    profile::null_profiler prof_;
+
+    // the edges of each sample
+    std::vector<edge_list> edges_;
+    weight_type weight_;
+
+    // the states of the table before deleting the vertex at position i
+    std::vector<connectivity>
+    undelete(std::size_t i, table_type const& before,
+             std::vector<connectivity> const& target)
+    {
+      chooser<weight_type, entry const*> ch(target);
+      auto offer = [&] {
+        for (auto const& s : before) {
+          auto c = op_.delete_node(s.first, i);
+          if (c and op_.how_many_endpoints(*c) <= 2)
+            ch.offer(*c, s.second, &s);
+        }
+      };
+      offer();
+      ch.draw(draw_);
+      offer();
+
+      std::vector<connectivity> result;
+      for (auto s : ch.chosen())
+        result.push_back(s->first);
+      return result;
+    }
+
+    // the states of the table before the join of edge k, taking the edge
+    // for the samples that need it
+    std::vector<connectivity>
+    unjoin(unsigned int b, unsigned int k, table_type const& before,
+           std::vector<connectivity> const& target)
+    {
+      auto const& e = t_.edge(k);
+      auto const i = t_.index(b, e.first), j = t_.index(b, e.second);
+
+      typedef std::pair<entry const*, bool> transition;
+      chooser<weight_type, transition> ch(target);
+      auto offer = [&] {
+        for (auto const& s : before) {
+          ch.offer(s.first, s.second, transition(&s, false));
+          auto c = op_.connect(s.first, i, j);
+          if (c and op_.how_many_endpoints(*c) <= 2) {
+            ch.offer(op_.canonicalize(*c), mul_var(s.second, t_.edge_class(k)),
+                     transition(&s, true));
+          }
+        }
+      };
+      offer();
+      ch.draw(draw_);
+      offer();
+
+      std::vector<connectivity> result;
+      auto const& chosen = ch.chosen();
+      for (std::size_t s = 0; s < chosen.size(); ++s) {
+        result.push_back(chosen[s].first->first);
+        if (chosen[s].second)
+          edges_[s].push_back(e);
+      }
+      return result;
+    }
+
+    // the states of A and of B before their fusion
+    std::pair<std::vector<connectivity>, std::vector<connectivity> >
+    unfuse(std::vector<unsigned int> const& A_to_B, table_type const& A_table,
+           table_type const& B_table, std::vector<connectivity> const& target)
+    {
+      typedef std::pair<entry const*, entry const*> transition;
+      chooser<weight_type, transition> ch(target);
+      auto offer = [&] {
+        for (auto const& a : A_table) {
+          connectivity newa;
+          for (auto const& b : B_table) {
+            auto const n = b.first.size();
+            if (n != newa.size() and not op_.is_finished(b.first) and
+                not op_.is_finished(a.first))
+              newa = op_.in_order(a.first, A_to_B, n);
+            if (auto c = op_.fuse(a.first, newa, b.first))
+              ch.offer(*c, a.second * b.second, transition(&a, &b));
+          }
+        }
+      };
+      offer();
+      ch.draw(draw_);
+      offer();
+
+      std::pair<std::vector<connectivity>, std::vector<connectivity> > result;
+      for (auto const& x : ch.chosen()) {
+        result.first.push_back(x.first->first);
+        result.second.push_back(x.second->first);
+      }
+      return result;
+    }
+
+    /*
+     *  Computes the table of bag b again from those of its children, as
+     *  bag_table does, keeping the input of each step, and traces the
+     *  samples back to the states of the children. At the root the
+     *  samples start from the end of the transfer, otherwise target[s] is
+     *  the state of sample s in the table of b.
+     */
+    std::vector<std::vector<connectivity> >
+    bag(unsigned int b, std::vector<std::pair<unsigned int, table_type> > children,
+        std::vector<connectivity> target, bool root)
+    {
+      // the input of each fusion and of each delete before it, by child
+      std::vector<table_type> fused{ op_.empty_state(t_.bag_size(b)) };
+      std::vector<std::vector<table_type> > deleted(children.size());
+      std::vector<std::vector<std::size_t> > positions(children.size());
+      std::vector<std::vector<unsigned int> > A_to_B(children.size());
+      for (std::size_t k = 0; k < children.size(); ++k) {
+        auto const b_sib = children[k].first;
+        deleted[k].push_back(std::move(children[k].second));
+        std::vector<unsigned int> left_over;
+        for (auto v : t_.vertices(b_sib)) {
+          if (t_.has(b, v)) {
+            left_over.push_back(v);
+          } else {
+            positions[k].push_back(left_over.size());
+            deleted[k].push_back(op_.delete_operator(left_over.size(), deleted[k].back()));
+          }
+        }
+        for (auto v : left_over)
+          A_to_B[k].push_back(t_.index(b, v));
+        fused.push_back(op_.table_fusion(A_to_B[k], deleted[k].back(), fused.back()));
+      }
+
+      // the input of each join
+      std::vector<table_type> joined{ std::move(fused.back()) };
+      fused.pop_back();
+      for (auto k = t_[b].edge_begin; k < t_[b].edge_end; ++k) {
+        auto const& e = t_.edge(k);
+        joined.push_back(op_.join_operator(t_.index(b, e.first), t_.index(b, e.second),
+                                           joined.back(), t_.edge_class(k)));
+      }
+
+      // pruning keeps the states the samples go through
+      if (root) {
+        auto table = std::move(joined.back());
+        joined.pop_back();
+        if (op_.prune)
+          table = op_.prune_operator(t_.exhausted(b), std::move(table));
+
+        // deleting the vertices in order, as transfer does
+        std::vector<table_type> before{ std::move(table) };
+        for (auto n = t_.bag_size(b); n > 0; --n)
+          before.push_back(op_.delete_operator(0, before.back()));
+        weight_ = op_.finish(before.back());
+        before.pop_back();
+        target.assign(edges_.size(), connectivity());
+        for (; not before.empty(); before.pop_back())
+          target = undelete(0, before.back(), target);
+      } else {
+        joined.pop_back();
+      }
+
+      for (auto k = t_[b].edge_end; k > t_[b].edge_begin; --k) {
+        target = unjoin(b, k - 1, joined.back(), target);
+        joined.pop_back();
+      }
+
+      std::vector<std::vector<connectivity> > result(children.size());
+      for (auto k = children.size(); k > 0; --k) {
+        auto before = unfuse(A_to_B[k - 1], deleted[k - 1].back(), fused.back(), target);
+        fused.pop_back();
+        target = std::move(before.second);
+        result[k - 1] = std::move(before.first);
+        deleted[k - 1].pop_back();
+        for (auto p = positions[k - 1].size(); p > 0; --p) {
+          result[k - 1] = undelete(positions[k - 1][p - 1], deleted[k - 1].back(),
+                                   result[k - 1]);
+          deleted[k - 1].pop_back();
+        }
+      }
+      return result;
+    }
+
+  public:
+    traceback(Operators const& op, flat_tree const& t, std::size_t n, Draw const& draw)
+      : op_(op), t_(t), draw_(draw), edges_(n), weight_()
+    {
+    }
+
+    // the samples through the subtree of b, see bag
+    void subtree(unsigned int b, std::vector<connectivity> target, bool root)
+    {
+      // the heavy path from b, and the bags whose table is kept: the
+      // children of the bags on the path
+      auto const first = t_.first(b);
+      std::vector<unsigned int> path{ b };
+      std::vector<char> keep(b - first + 1);
+      for (;;) {
+        auto const children = t_.children(path.back());
+        if (children.empty())
+          break;
+        auto heavy = children.front();
+        for (auto c : children) {
+          keep[c - first] = true;
+          if (c - t_.first(c) > heavy - t_.first(heavy))
+            heavy = c;
+        }
+        path.push_back(heavy);
+      }
+
+      std::map<unsigned int, table_type> kept;
+      transfer::subtree(op_, t_, b, prof_, [&](unsigned int c, table_type const& table) {
+        if (keep[c - first])
+          kept.insert(std::make_pair(c, table));
+      });
+
+      // down the path, the subtrees hanging off it afterwards
+      std::vector<std::pair<unsigned int, std::vector<connectivity> > > light;
+      for (std::size_t p = 0; p < path.size(); ++p) {
+        auto const children = t_.children(path[p]);
+        std::vector<std::pair<unsigned int, table_type> > tables;
+        for (auto c : children) {
+          tables.push_back(std::make_pair(c, std::move(kept[c])));
+          kept.erase(c);
+        }
+        auto before = bag(path[p], std::move(tables), std::move(target), root and p == 0);
+        for (std::size_t k = 0; k < children.size(); ++k) {
+          if (p + 1 < path.size() and children[k] == path[p + 1])
+            target = std::move(before[k]);
+          else
+            light.push_back(std::make_pair(children[k], std::move(before[k])));
+        }
+      }
+      for (auto& l : light)
+        subtree(l.first, std::move(l.second), false);
+    }
+
+    std::vector<edge_list> const& edges() const { return edges_; }
+    weight_type const& weight() const { return weight_; }
+  };
+
+  // the vertices of a path given by its edges, from its smaller end
+  inline std::vector<unsigned int> walk(edge_list const& edges)
+  {
+    std::vector<unsigned int> path;
+    if (edges.empty())
+      return path;
+
+    std::map<unsigned int, std::vector<unsigned int> > next;
+    for (auto const& e : edges) {
+      next[e.first].push_back(e.second);
+      next[e.second].push_back(e.first);
+    }
+    auto v = next.begin()->first;
+    for (auto const& x : next) {
+      if (x.second.size() == 1) {
+        v = x.first;
+        break;
+      }
+    }
+
+    path.push_back(v);
+    for (std::size_t k = 0; k < edges.size(); ++k) {
+      auto const& n = next[path.back()];
+      auto const u = path.size() > 1 and n.front() == path[path.size() - 2] ? n.back() : n.front();
+      path.push_back(u);
+    }
+    assert(path.size() == next.size());
+    return path;
+  }
+
+  /*
+   *  n longest paths, as the sequence of their vertices, drawing each
+   *  transition with draw (uniform or first). weight is the longest
+   *  length and the number of paths of that length.
+   */
+  template<class Operators, class Draw>
+  std::vector<std::vector<unsigned int> >
+  paths(Operators const& op, flat_tree const& t, std::size_t n,
+        Draw const& draw, typename Operators::weight_type& weight)
+  {
+    traceback<Operators, Draw> tb(op, t, n, draw);
+    tb.subtree(t.root(), std::vector<connectivity>(n), true);
+    weight = tb.weight();
+
+    std::vector<std::vector<unsigned int> > result;
+    for (auto const& e : tb.edges())
+      result.push_back(walk(e));
+    return result;
+  }
+}
+
+#endif
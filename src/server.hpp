@@ -0,0 +1,407 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "batch.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ *  A long lived process listening on a Unix domain socket. A client sends
+ *  one job per line,
+ *
+ *    id <tab> graph [<tab> options]
+ *
+ *  the graph in the edges format and the options as on the command line
+ *  (--problem cycle --fill-in ...), or the line "!shutdown" to stop the
+ *  server once the jobs already queued are done. The jobs of all clients
+ *  go in one queue served by a pool of workers. A job is admitted to run
+ *  only when its estimated peak memory fits in what the running jobs leave
+ *  of the budget, a job larger than the whole budget running alone.
+ *
+ *  The server answers with lines of JSON: {"id", "status": "queued"} when
+ *  a job is received, {"id", "status": "running", "estimated_memory"} when
+ *  it is admitted, and then the same line as --batch. The connection is
+ *  closed once the client has closed its side, or the server is shutting
+ *  down, and all of its jobs are done. The listener is closed only when
+ *  all the connections have stopped reading.
+ */
+
+namespace server {
+
+  // the client side of a connection, shared by its reader and the workers
+  class connection {
+    int fd_;
+    std::mutex mutex_;
+
+  public:
+    explicit connection(int fd) : fd_(fd) { }
+    ~connection() { close(fd_); }
+
+    int fd() const { return fd_; }
+
+    // a client gone away is not an error, it just misses the answers
+    void send(std::string const& line)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto s = line + "\n";
+      for (std::size_t sent = 0; sent < s.size(); ) {
+        auto n = ::send(fd_, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+          return;
+        sent += n;
+      }
+    }
+  };
+
+  class admission {
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    long double budget_, used_;
+    unsigned int running_;
+
+  public:
+    explicit admission(long double budget)
+      : budget_(budget), used_(0), running_(0) { }
+
+    void acquire(long double bytes)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] {
+        return running_ == 0 or used_ + bytes <= budget_;
+      });
+      used_ += bytes;
+      ++ running_;
+    }
+
+    void release(long double bytes)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used_ -= bytes;
+      -- running_;
+      cv_.notify_all();
+    }
+  };
+
+  struct task {
+    std::shared_ptr<connection> client;
+    batch::job job;
+    std::vector<std::string> options;
+  };
+
+  /*
+   *  What a job sees of the server: admit blocks until the estimated
+   *  memory of the job fits, the memory is given back when the job ends.
+   */
+  class context {
+    admission& admission_;
+    connection& client_;
+    std::string id_;
+    long double bytes_;
+    bool admitted_;
+
+  public:
+    context(admission& a, connection& client, std::string const& id)
+      : admission_(a), client_(client), id_(id), bytes_(0), admitted_(false) { }
+
+    ~context()
+    {
+      if (admitted_)
+        admission_.release(bytes_);
+    }
+
+    void admit(long double bytes)
+    {
+      admission_.acquire(bytes);
+      bytes_ = bytes;
+      admitted_ = true;
+      std::ostringstream line;
+      line << "{\"id\": " << batch::json_string(id_)
+           << ", \"status\": \"running\", \"estimated_memory\": "
+           << static_cast<unsigned long long>(bytes) << "}";
+      client_.send(line.str());
+    }
+  };
+
+  class queue {
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<task> tasks_;
+    bool closed_;
+
+  public:
+    queue() : closed_(false) { }
+
+    bool push(task t)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closed_)
+        return false;
+      tasks_.push_back(std::move(t));
+      cv_.notify_one();
+      return true;
+    }
+
+    // false once closed and empty
+    bool pop(task& t)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] { return closed_ or not tasks_.empty(); });
+      if (tasks_.empty())
+        return false;
+      t = std::move(tasks_.front());
+      tasks_.pop_front();
+      return true;
+    }
+
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+      cv_.notify_all();
+    }
+  };
+
+  inline std::vector<std::string> split(std::string const& s)
+  {
+    std::istringstream in(s);
+    std::vector<std::string> words;
+    std::string w;
+    while (in >> w)
+      words.push_back(w);
+    return words;
+  }
+
+  /*
+   *  Serves until a client asks to shut down. solve(job, options, context)
+   *  returns the fields of the answer after the id, as for batch::run.
+   */
+  template<class Solve>
+  void serve(std::string const& path, unsigned int num_threads,
+             long double memory_budget, Solve solve)
+  {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+      throw std::runtime_error("cannot create a socket");
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof address.sun_path)
+      throw std::runtime_error("socket path too long: " + path);
+    std::strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0 or
+        listen(listener, 16) < 0) {
+      close(listener);
+      throw std::runtime_error("cannot listen on " + path);
+    }
+    std::cerr << "Listening on " << path << "\n";
+
+    // written to once a client asks to shut down, and never read: the
+    // listener and the readers all poll it
+    int wake[2];
+    if (pipe(wake) < 0) {
+      close(listener);
+      throw std::runtime_error("cannot create a pipe");
+    }
+
+    queue jobs;
+    admission memory(memory_budget);
+
+    auto worker = [&]() {
+      task t;
+      while (jobs.pop(t)) {
+        std::ostringstream line;
+        line << "{\"id\": " << batch::json_string(t.job.id);
+        try {
+          context ctx(memory, *t.client, t.job.id);
+          auto fields = solve(t.job, t.options, ctx);
+          line << ", " << fields;
+        } catch (std::exception& e) {
+          line << ", \"error\": " << batch::json_string(e.what());
+        }
+        line << "}";
+        t.client->send(line.str());
+        t.client.reset();
+      }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < num_threads; ++i)
+      workers.emplace_back(worker);
+
+    // until the client closes its side or the server shuts down, lines
+    // left unread then would only be refused
+    auto reader = [&](std::shared_ptr<connection> client, std::atomic<bool>& done) {
+      std::string pending;
+      unsigned int line_number = 0;
+      char buffer[4096];
+      pollfd fds[2] = {{client->fd(), POLLIN, 0}, {wake[0], POLLIN, 0}};
+      for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+          if (errno == EINTR)
+            continue;
+          break;
+        }
+        if (fds[1].revents != 0)
+          break;
+        auto n = read(client->fd(), buffer, sizeof buffer);
+        if (n <= 0)
+          break;
+        pending.append(buffer, n);
+        std::size_t eol;
+        while ((eol = pending.find('\n')) != std::string::npos) {
+          auto line = pending.substr(0, eol);
+          pending.erase(0, eol + 1);
+          ++ line_number;
+          if (line.empty() or line[0] == '#')
+            continue;
+          if (line == "!shutdown") {
+            jobs.close();
+            auto woken = write(wake[1], "", 1);
+            (void) woken;
+            continue;
+          }
+
+          task t;
+          t.client = client;
+          std::size_t tab = line.find('\t');
+          if (tab == std::string::npos) {
+            t.job.id = std::to_string(line_number);
+            t.job.text = line;
+          } else {
+            t.job.id = line.substr(0, tab);
+            auto rest = line.substr(tab + 1);
+            std::size_t tab2 = rest.find('\t');
+            t.job.text = rest.substr(0, tab2);
+            if (tab2 != std::string::npos)
+              t.options = split(rest.substr(tab2 + 1));
+          }
+          t.job.is_file = false;
+
+          // queued goes out first, a worker may pick the job right away
+          auto id = batch::json_string(t.job.id);
+          client->send("{\"id\": " + id + ", \"status\": \"queued\"}");
+          if (not jobs.push(std::move(t)))
+            client->send("{\"id\": " + id + ", \"error\": \"the server is shutting down\"}");
+        }
+      }
+      done = true;
+    };
+
+    // the readers, those of closed connections joined at the next accept
+    struct reading {
+      std::thread thread;
+      std::unique_ptr<std::atomic<bool> > done;
+    };
+    std::vector<reading> readers;
+
+    pollfd fds[2] = {{listener, POLLIN, 0}, {wake[0], POLLIN, 0}};
+    for (;;) {
+      if (poll(fds, 2, -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      if (fds[1].revents != 0)
+        break;
+      int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0)
+        continue;
+      auto client = std::make_shared<connection>(fd);
+
+      for (auto r = readers.begin(); r != readers.end(); ) {
+        if (*r->done) {
+          r->thread.join();
+          r = readers.erase(r);
+        } else {
+          ++ r;
+        }
+      }
+      reading r;
+      r.done.reset(new std::atomic<bool>(false));
+      r.thread = std::thread(reader, client, std::ref(*r.done));
+      readers.push_back(std::move(r));
+    }
+
+    // the readers stop too if the listener failed
+    jobs.close();
+    auto woken = write(wake[1], "", 1);
+    (void) woken;
+    for (auto& r : readers)
+      r.thread.join();
+    for (auto& w : workers)
+      w.join();
+    close(wake[0]);
+    close(wake[1]);
+    close(listener);
+    unlink(path.c_str());
+  }
+
+  // sends the lines of in to the server and copies its answers to out
+  inline void client(std::string const& path, std::istream& in, std::ostream& out)
+  {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    if (fd < 0 or path.size() >= sizeof address.sun_path)
+      throw std::runtime_error("cannot connect to " + path);
+    std::strcpy(address.sun_path, path.c_str());
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0) {
+      close(fd);
+      throw std::runtime_error("cannot connect to " + path);
+    }
+
+    connection server(fd);
+    std::thread sender([&] {
+      std::string line;
+      while (std::getline(in, line))
+        server.send(line);
+      shutdown(fd, SHUT_WR);
+    });
+
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof buffer)) > 0)
+      out.write(buffer, n);
+    out.flush();
+    sender.join();
+  }
+}
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef STRIP_HPP
+#define STRIP_HPP
+
+#include "lattice.hpp"
+#include "operators.hpp"
+#include "tree_decomposition/flat_tree.hpp"
+#include "tree_decomposition/tree_decomposition.hpp"
+
+#include <boost/graph/graph_traits.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ *  Transfer matrix along a lattice strip. Vertices are added to the
+ *  boundary one at a time in index order (column by column) and joined
+ *  to their neighbours in the previous column, which are dropped from
+ *  the boundary as soon as they have no edges left. Once a column is
+ *  complete the edges inside it are added, and a copy of the boundary
+ *  table is closed off, giving the result for the strip of that
+ *  length: one pass yields the results for all lengths 1..L.
+ *
+ *  Optionally, an automorphism of the lattice mapping every column onto
+ *  itself (e.g. the reflection of the strip) is used to fold the table
+ *  at the end of each column: the boundary is then exactly the column,
+ *  everything still to come is mapped onto itself, so a state and its
+ *  images give the same contribution to every result. Each orbit is
+ *  kept as its smallest state, with the total weight of the orbit, and
+ *  the tables are about halved for a reflection.
+ */
+
+namespace strip {
+  using tree_decomposition::vertex_list;
+
+  // close off a copy of the boundary table
+  template<class Operators>
+  typename Operators::weight_type
+  close(const Operators& op, vertex_list const& boundary,
+        typename Operators::table_type table)
+  {
+    vertex_list v_to_remove(boundary);
+    for (auto v : boundary) {
+      table = op.delete_operator(v_to_remove.index(v), table);
+      v_to_remove.remove(v);
+    }
+    return op.finish(table);
+  }
+
+  // throws unless sigma is an automorphism of l mapping each column onto itself
+  inline void check_symmetry(lattice::lattice const& l,
+                             std::vector<unsigned int> const& sigma)
+  {
+    using namespace boost;
+    auto const n = l.width * l.length;
+    if (sigma.size() != n)
+      throw std::runtime_error("the automorphism must list every vertex");
+    std::vector<bool> seen(n, false);
+    for (unsigned int v = 0; v < n; ++v) {
+      if (sigma[v] >= n or seen[sigma[v]])
+        throw std::runtime_error("the automorphism is not a permutation");
+      seen[sigma[v]] = true;
+      if (sigma[v] / l.width != v / l.width)
+        throw std::runtime_error("the automorphism must map each column onto itself");
+    }
+    for (auto e : as_range(edges(l.graph))) {
+      auto a = get(vertex_index, l.graph, source(e, l.graph));
+      auto b = get(vertex_index, l.graph, target(e, l.graph));
+      if (not edge(vertex(sigma[a], l.graph), vertex(sigma[b], l.graph), l.graph).second)
+        throw std::runtime_error("the permutation is not an automorphism of the lattice");
+      if (lattice::edge_class(l, sigma[a], sigma[b]) != lattice::edge_class(l, a, b))
+        throw std::runtime_error("the automorphism must preserve edge directions");
+    }
+  }
+
+  // keep each orbit of the group acting on the positions as its smallest state
+  template<class Operators>
+  typename Operators::table_type
+  fold(const Operators& op, std::vector<std::vector<unsigned int> > const& group,
+       typename Operators::table_type const& table)
+  {
+    typename Operators::table_type new_table;
+    for (auto const& state : table) {
+      auto rep = state.first;
+      for (auto const& p : group)
+        rep = std::min(rep, op.permute(state.first, p));
+      new_table[rep] += state.second;
+    }
+    return new_table;
+  }
+
+  /*
+   *  sigma, if not empty, is an automorphism of l mapping every column
+   *  onto itself, see check_symmetry
+   */
+  template<class Operators, class Callback>
+  void transfer(const Operators& op, lattice::lattice const& l, Callback f,
+                std::vector<unsigned int> const& sigma = std::vector<unsigned int>())
+  {
+    static_assert(operators::check<Operators>::value, "not an operator set");
+    using namespace boost;
+    auto const n = l.width * l.length;
+    auto column = [&](unsigned int v) { return v / l.width; };
+
+    // for each vertex, its neighbours and the last one to be added
+    std::vector<std::vector<unsigned int> > neighbours(n);
+    std::vector<unsigned int> last(n);
+    for (auto v : as_range(vertices(l.graph))) {
+      auto vi = get(vertex_index, l.graph, v);
+      last[vi] = vi;
+      for (auto u : as_range(adjacent_vertices(v, l.graph))) {
+        auto ui = get(vertex_index, l.graph, u);
+        neighbours[vi].push_back(ui);
+        last[vi] = std::max(last[vi], ui);
+      }
+    }
+
+    // the boundary is widest as a vertex is added, before the vertices of
+    // the previous column go: u goes once it is past last[u] and its column
+    std::vector<unsigned int> drops(n, 0);
+    for (unsigned int u = 0; u < n; ++u) {
+      auto const d = std::max(last[u], (column(u) + 1) * l.width);
+      if (d < n)
+        ++ drops[d];
+    }
+    std::size_t size = 0, widest = 0;
+    for (unsigned int v = 0; v < n; ++v) {
+      widest = std::max(widest, ++ size);
+      size -= drops[v];
+    }
+    if (widest > tree_decomposition::flat_tree::widest_bag)
+      throw std::runtime_error("the boundary of the strip has " + std::to_string(widest) +
+                               " vertices, at most " +
+                               std::to_string(tree_decomposition::flat_tree::widest_bag) +
+                               " are supported");
+
+    vertex_list boundary;
+    boundary.insert(0);
+    auto table = op.empty_state(1);
+
+    for (unsigned int v = 0; v < n; ++v) {
+      if (v > 0) {
+        // add v to the boundary, it always goes last
+        std::vector<unsigned int> A_to_B(boundary.size());
+        for (unsigned int i = 0; i < A_to_B.size(); ++i)
+          A_to_B[i] = i;
+        boundary.insert(v);
+        table = op.table_fusion(A_to_B, table, op.empty_state(boundary.size()));
+      }
+
+      // join v with its neighbours in the previous column
+      for (auto u : neighbours[v]) {
+        if (column(u) < column(v))
+          table = op.join_operator(boundary.index(u), boundary.index(v), table,
+                                   lattice::edge_class(l, u, v));
+      }
+
+      // drop the vertices of the previous column with no edges left
+      vertex_list left_over(boundary);
+      for (auto u : left_over) {
+        if (column(u) < column(v) and last[u] <= v) {
+          table = op.delete_operator(boundary.index(u), table);
+          boundary.remove(u);
+        }
+      }
+
+      if ((v + 1) % l.width != 0)
+        continue;
+
+      // the column is complete, now the edges inside it
+      for (auto w : boundary) {
+        for (auto u : neighbours[w]) {
+          if (w < u and column(u) == column(w))
+            table = op.join_operator(boundary.index(w), boundary.index(u), table,
+                                     lattice::edge_class(l, w, u));
+        }
+      }
+
+      if (not sigma.empty()) {
+        // the powers of sigma on the positions of this column, but the identity
+        auto const first = column(v) * l.width;
+        assert(boundary.size() == l.width and *boundary.begin() == first);
+        std::vector<std::vector<unsigned int> > group;
+        std::vector<unsigned int> p(l.width);
+        for (unsigned int i = 0; i < l.width; ++i)
+          p[i] = sigma[first + i] - first;
+        for (auto q = p; ; ) {
+          bool identity = true;
+          for (unsigned int i = 0; i < l.width; ++i)
+            identity = identity and q[i] == i;
+          if (identity)
+            break;
+          group.push_back(q);
+          for (auto& x : q)
+            x = p[x];
+        }
+        table = fold(op, group, table);
+      }
+
+      f(column(v) + 1, close(op, boundary, table));
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef TABLES_HPP
+#define TABLES_HPP
+
+#include "utility/arena.hpp"
+#include "utility/radix_sort.hpp"
+
+#include "boost/unordered/unordered_map.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+/*
+ *  The tables of the operator sets built on strands, mapping states to
+ *  weights. The operators only add to the weight of a state, with
+ *  table[state] += weight, iterate over a table and drop some of its
+ *  states with drop_if, so there are two ways of keeping them:
+ *
+ *  hash_table    a hash map, the weight of a state is updated in place.
+ *                Its entries come from an arena of its own and are let go
+ *                together with the table;
+ *
+ *  sorted_table  an array of (state, weight) sorted by state. A new entry
+ *                is appended, and the entries appended so far are radix
+ *                sorted and merged, adding up the weights of equal states,
+ *                when the table is next read (or when they outnumber the
+ *                sorted ones, to keep the memory bounded). There is no
+ *                overhead per entry and the table is read in order.
+ */
+
+template<class Key, class Value>
+using hash_table = boost::unordered_map<Key, Value, boost::hash<Key>, std::equal_to<Key>,
+                                        arena_allocator<std::pair<Key const, Value> > >;
+
+template<class Key, class Value, class Hash, class Equal, class Alloc, class Pred>
+void drop_if(boost::unordered_map<Key, Value, Hash, Equal, Alloc>& table, Pred pred)
+{
+  for (auto i = table.begin(); i != table.end(); ) {
+    if (pred(*i))
+      i = table.erase(i);
+    else
+      ++ i;
+  }
+}
+
+/*
+ *  The keys are sequences of int8_t no smaller than -1, as are the states
+ *  of connectivity_states.
+ */
+template<class Key, class Value>
+class sorted_table
+{
+public:
+  typedef Key key_type;
+  typedef Value mapped_type;
+  typedef std::pair<Key, Value> value_type;
+  typedef typename std::vector<value_type>::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  sorted_table() : sorted_(0) { }
+
+  sorted_table(std::initializer_list<value_type> entries)
+    : entries_(entries), sorted_(0)
+  {
+  }
+
+  // the weight of a new entry for key, to be added to right away
+  Value& operator[](Key key)
+  {
+    auto const pending = entries_.size() - sorted_;
+    if (pending >= std::max<std::size_t>(sorted_, 1 << 12))
+      compact();
+    entries_.emplace_back(std::move(key), Value());
+    return entries_.back().second;
+  }
+
+  const_iterator begin() const { compact(); return entries_.begin(); }
+  const_iterator end() const { compact(); return entries_.end(); }
+
+  std::size_t size() const { compact(); return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  template<class Pred>
+  friend void drop_if(sorted_table& table, Pred pred)
+  {
+    table.compact();
+    auto& e = table.entries_;
+    e.erase(std::remove_if(e.begin(), e.end(), pred), e.end());
+    table.sorted_ = e.size();
+  }
+
+private:
+  // sorts the entries appended since the last time and merges them in
+  void compact() const
+  {
+    if (sorted_ == entries_.size())
+      return;
+
+    // the keys packed in rows of the same width, padded with zeros, each
+    // byte shifted up by two so that padding comes first
+    std::size_t const n = entries_.size() - sorted_;
+    std::size_t width = 0;
+    for (auto i = sorted_; i < entries_.size(); ++i)
+      width = std::max(width, entries_[i].first.size());
+    std::vector<uint8_t> rows(n * width);
+    for (std::size_t i = 0; i < n; ++i) {
+      auto const& key = entries_[sorted_ + i].first;
+      for (std::size_t p = 0; p < key.size(); ++p) {
+        assert(key[p] >= -1);
+        rows[i * width + p] = key[p] + 2;
+      }
+    }
+    auto const order = radix::sort(rows, n, width);
+    rows = std::vector<uint8_t>();
+
+    std::vector<value_type> run;
+    run.reserve(n);
+    for (auto i : order) {
+      auto& e = entries_[sorted_ + i];
+      if (not run.empty() and run.back().first == e.first)
+        run.back().second += std::move(e.second);
+      else
+        run.push_back(std::move(e));
+    }
+
+    // merge from the back, in the room the new entries leave
+    entries_.resize(sorted_);
+    entries_.resize(sorted_ + run.size());
+    auto w = entries_.end();
+    auto i = entries_.begin() + sorted_;
+    auto j = run.end();
+    while (j != run.begin()) {
+      if (i == entries_.begin() or (i - 1)->first < (j - 1)->first) {
+        *--w = std::move(*--j);
+        continue;
+      }
+      bool const equal = not ((j - 1)->first < (i - 1)->first);
+      if (--w != --i)
+        *w = std::move(*i);
+      if (equal)
+        w->second += std::move((--j)->second);
+    }
+    // equal states leave a gap between the two
+    if (w != i)
+      entries_.erase(std::move(w, entries_.end(), i), entries_.end());
+    sorted_ = entries_.size();
+  }
+
+  // sorted by key up to sorted_, then in the order they were added; the
+  // table only changes its representation when read
+  mutable std::vector<value_type> entries_;
+  mutable std::size_t sorted_;
+};
+
+#endif
@@ -19,74 +19,208 @@
 #ifndef TRANSFER_HPP
 #define TRANSFER_HPP
 
+#include "memo.hpp"
+#include "operators.hpp"
+#include "profile.hpp"
+#include "tree_decomposition/flat_tree.hpp"
 #include "tree_decomposition/tree_decomposition.hpp"
-#include <boost/range/algorithm/set_algorithm.hpp>
+
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace transfer {
   using tree_decomposition::vertex_list;
   using tree_decomposition::bag_ptr;
+  using tree_decomposition::flat_tree;
 
-  template<class Operators>
+  /*
+   *  The table of bag b from the tables of its children, given as (bag,
+   *  table) pairs in the order they were visited. The tables are moved
+   *  from.
+   */
+  template<class Operators, class Profiler, class Iterator>
   typename Operators::table_type
-  recurse(const Operators& op, bag_ptr b)
+  bag_table(const Operators& op, flat_tree const& t, unsigned int b,
+            Iterator first_child, Iterator last_child, Profiler& prof)
   {
+    prof.begin_bag(b, t.bag_size(b));
+
     // create a new table containing only the empty state
-    auto const n = b->vertices.size();
-    auto table = op.empty_state(n);
-
-    // iterates over children
-    for (auto b_sib : b->children) {
-      // recurse
-      auto table_sib = recurse(op, b_sib);
-
-      // diffe contains the vertices in b_sib which are not in b (the parent bag)
-      std::vector<unsigned int> diffe;
-      boost::set_difference(b_sib->vertices, b->vertices, std::back_inserter(diffe));
-
-      // delete each vertex not present in the parent bag
-
-      // we need to make a copy first because
-      // 1) we need to keep the indices consistent while removing vertices
-      // 2) we don't want to destroy the tree decomposition
-      vertex_list b_sib_left_over(b_sib->vertices);
-      for (auto v : diffe) {
-        table_sib = op.delete_operator(b_sib_left_over.index(v), table_sib);
-        b_sib_left_over.remove(v);
+    auto table = op.empty_state(t.bag_size(b));
+
+    // keep a representative set of the states after each fusion and after
+    // the joins, not after each join: one drops too few states to pay off
+    auto reduce = [&] {
+      if (op.reduce) {
+        table = prof.record("reduce", b, table.size(), [&] {
+          return op.reduce_operator(table);
+        });
+      }
+    };
+
+    for (auto k = first_child; k != last_child; ++k) {
+      auto const b_sib = k->first;
+      auto table_sib = std::move(k->second);
+
+      // delete each vertex of b_sib not present in the parent bag b,
+      // keeping track of the indices as vertices are removed
+      std::vector<unsigned int> b_sib_left_over;
+      for (auto v : t.vertices(b_sib)) {
+        if (t.has(b, v)) {
+          b_sib_left_over.push_back(v);
+        } else {
+          auto const i = b_sib_left_over.size();
+          table_sib = prof.record("delete", b_sib, table_sib.size(), [&] {
+            return op.delete_operator(i, table_sib);
+          });
+        }
       }
 
       // create b_sib to b bag mapping
       auto const A_size = b_sib_left_over.size();
       std::vector<unsigned int> A_to_B(A_size);
       for (unsigned int i = 0; i < A_size; ++i)
-        A_to_B[i] = b->vertices.index(b_sib_left_over.at(i));
+        A_to_B[i] = t.index(b, b_sib_left_over[i]);
 
-      table = op.table_fusion(A_to_B, table_sib, table);
+      table = prof.record("fusion", b, table_sib.size() + table.size(), [&] {
+        return op.table_fusion(A_to_B, table_sib, table, prof.counter());
+      });
+      reduce();
     }
 
     // apply the join operator for each edge in the bag
-    for (auto e : b->edges) {
-      table = op.join_operator(b->vertices.index(e.first),
-        b->vertices.index(e.second), table);
+    for (auto k = t[b].edge_begin; k < t[b].edge_end; ++k) {
+      auto const& e = t.edge(k);
+      table = prof.record("join", b, table.size(), [&] {
+        return op.join_operator(t.index(b, e.first), t.index(b, e.second),
+                                table, t.edge_class(k));
+      });
+    }
+    reduce();
+
+    // drop the states that cannot be completed with the edges left
+    if (op.prune) {
+      table = prof.record("prune", b, table.size(), [&] {
+        return op.prune_operator(t.exhausted(b), std::move(table));
+      });
     }
+    prof.end_bag(b, table.size());
     return table;
   }
 
+  // with memoize, the subtrees with the same structure are computed only
+  // once, see memo.hpp
+  template<class Operators, class Profiler>
+  typename Operators::table_type
+  recurse(const Operators& op, flat_tree const& t, Profiler& prof,
+          bool memoize = false)
+  {
+    static_assert(operators::check<Operators>::value, "not an operator set");
+    using table_type = typename Operators::table_type;
+
+    // tables of the subtrees visited so far, with the index of their root
+    std::vector<std::pair<unsigned int, table_type> > stack;
+
+    std::unique_ptr<memo::cache<table_type> > cache;
+    if (memoize)
+      cache.reset(new memo::cache<table_type>(t, op.prune));
+
+    for (unsigned int b = 0; b < t.size(); ++b) {
+      // skip the largest subtree starting here with a known table
+      unsigned int a;
+      table_type known;
+      if (cache and cache->lookup(b, a, known)) {
+        known = prof.record("memo", a, known.size(), [&] {
+          return std::move(known);
+        });
+        stack.push_back(std::make_pair(a, std::move(known)));
+        b = a;
+        continue;
+      }
+
+      // the children tables are the last ones on the stack
+      auto const first_child = stack.end() - t[b].num_children;
+      auto table = bag_table(op, t, b, first_child, stack.end(), prof);
+      stack.erase(first_child, stack.end());
+      if (cache)
+        cache->store(b, table);
+      stack.push_back(std::make_pair(b, std::move(table)));
+    }
+
+    assert(stack.size() == 1);
+    return std::move(stack.back().second);
+  }
+
+  // the table of the subtree of bag root, visit(b, table) being called
+  // with the table of each of its bags
+  template<class Operators, class Profiler, class Visitor>
+  typename Operators::table_type
+  subtree(const Operators& op, flat_tree const& t, unsigned int root,
+          Profiler& prof, Visitor visit)
+  {
+    static_assert(operators::check<Operators>::value, "not an operator set");
+    using table_type = typename Operators::table_type;
+
+    std::vector<std::pair<unsigned int, table_type> > stack;
+    for (auto b = t.first(root); b <= root; ++b) {
+      auto const first_child = stack.end() - t[b].num_children;
+      auto table = bag_table(op, t, b, first_child, stack.end(), prof);
+      stack.erase(first_child, stack.end());
+      visit(b, static_cast<table_type const&>(table));
+      stack.push_back(std::make_pair(b, std::move(table)));
+    }
+
+    assert(stack.size() == 1);
+    return std::move(stack.back().second);
+  }
+
+  template<class Operators>
+  typename Operators::table_type
+  recurse(const Operators& op, flat_tree const& t)
+  {
+    profile::null_profiler prof;
+    return recurse(op, t, prof);
+  }
+
   template<class Operators>
+  typename Operators::table_type
+  recurse(const Operators& op, bag_ptr b)
+  {
+    return recurse(op, flat_tree(b));
+  }
+
+  template<class Operators, class Profiler>
   typename Operators::weight_type
-  transfer(const Operators& op, bag_ptr b)
+  transfer(const Operators& op, flat_tree const& t, Profiler& prof,
+           bool memoize = false)
   {
-    auto table = recurse(op, b);
-
-    // we need to make a copy first because
-    // 1) we need to keep the indices consistent while removing vertices
-    // 2) we don't want to destroy the tree decomposition
-    vertex_list v_to_remove(b->vertices);
-    for (auto v : b->vertices) {
-      table = op.delete_operator(v_to_remove.index(v), table);
-      v_to_remove.remove(v);
+    auto table = recurse(op, t, prof, memoize);
+
+    // deleting the vertices in order, each one is the first left
+    for (auto n = t.bag_size(t.root()); n > 0; --n) {
+      table = prof.record("delete", t.root(), table.size(), [&] {
+        return op.delete_operator(0, table);
+      });
     }
-    assert(table.size() == 1);
-    return table.begin()->second;
+
+    return op.finish(table);
+  }
+
+  template<class Operators>
+  typename Operators::weight_type
+  transfer(const Operators& op, flat_tree const& t)
+  {
+    profile::null_profiler prof;
+    return transfer(op, t, prof);
+  }
+
+  template<class Operators>
+  typename Operators::weight_type
+  transfer(const Operators& op, bag_ptr b)
+  {
+    return transfer(op, flat_tree(b));
   }
 }
 
@@ -0,0 +1,221 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef FLAT_TREE_HPP
+#define FLAT_TREE_HPP
+
+#include "tree_decomposition.hpp"
+
+#include <boost/range/iterator_range.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ *  A tree decomposition stored in three arrays: bags in post-order (the
+ *  root last), and the vertices and edges of all bags one after the
+ *  other. The children of a bag are the subtrees right before it, so a
+ *  post-order walk only needs a stack of results and no recursion.
+ *
+ *  Each graph edge belongs to a single bag. A vertex of a bag is
+ *  exhausted when all of its edges belong to the subtree of that bag,
+ *  so nothing touches it after the bag has been processed.
+ *
+ *  A bag has at most widest_bag vertices: the states label the strand
+ *  ends of a bag with positive int8_t, at most one label per vertex.
+ */
+
+namespace tree_decomposition {
+  class flat_tree {
+  public:
+    struct bag {
+      uint vertex_begin, vertex_end;
+      uint edge_begin, edge_end;
+      uint num_children;
+    };
+
+    typedef boost::iterator_range<std::vector<uint>::const_iterator> vertex_range;
+    typedef boost::iterator_range<edge_list::const_iterator> edge_range;
+    typedef boost::iterator_range<std::vector<char>::const_iterator> exhausted_range;
+
+    static const uint widest_bag = 127;
+
+    explicit flat_tree(tree_decomposition t)
+    {
+      // iterative post-order visit: bag and next child to visit
+      std::vector<std::pair<bag_ptr, uint> > stack{ { t, 0 } };
+      while (not stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < top.first->children.size()) {
+          auto child = top.first->children[top.second++];
+          stack.push_back(std::make_pair(child, 0));
+          continue;
+        }
+
+        auto b = top.first;
+        if (b->vertices.size() > widest_bag)
+          throw std::runtime_error("a bag of the tree decomposition has " +
+                                   std::to_string(b->vertices.size()) +
+                                   " vertices, at most " +
+                                   std::to_string(widest_bag) + " are supported");
+        bag fb;
+        fb.vertex_begin = vertices_.size();
+        vertices_.insert(vertices_.end(), b->vertices.begin(), b->vertices.end());
+        fb.vertex_end = vertices_.size();
+        fb.edge_begin = edges_.size();
+        edges_.insert(edges_.end(), b->edges.begin(), b->edges.end());
+        fb.edge_end = edges_.size();
+        fb.num_children = b->children.size();
+        bags_.push_back(fb);
+        stack.pop_back();
+      }
+
+      // the first and last bag holding an edge of each vertex
+      uint const none = bags_.size();
+      std::vector<uint> first_edge, last_edge;
+      for (uint i = 0; i < bags_.size(); ++i) {
+        for (auto e : edges(i)) {
+          for (auto v : { e.first, e.second }) {
+            if (v >= first_edge.size()) {
+              first_edge.resize(v + 1, none);
+              last_edge.resize(v + 1, 0);
+            }
+            first_edge[v] = std::min(first_edge[v], i);
+            last_edge[v] = std::max(last_edge[v], i);
+          }
+        }
+      }
+
+      // the subtree of bag i is the range [first, i]
+      std::vector<uint> subtrees;
+      first_.resize(bags_.size());
+      exhausted_.resize(vertices_.size());
+      for (uint i = 0; i < bags_.size(); ++i) {
+        first_[i] = i;
+        for (uint k = 0; k < bags_[i].num_children; ++k) {
+          first_[i] = first_[subtrees.back()];
+          subtrees.pop_back();
+        }
+        subtrees.push_back(i);
+        for (uint k = bags_[i].vertex_begin; k < bags_[i].vertex_end; ++k) {
+          auto v = vertices_[k];
+          exhausted_[k] = v >= first_edge.size() or first_edge[v] == none or
+            (first_[i] <= first_edge[v] and last_edge[v] <= i);
+        }
+      }
+    }
+
+    std::size_t size() const { return bags_.size(); }
+    uint root() const { return bags_.size() - 1; }
+    bag const& operator[](uint i) const { return bags_[i]; }
+
+    // the subtree of bag i is the bags [first(i), i]
+    uint first(uint i) const { return first_[i]; }
+
+    // the children of bag i, in the order they are visited
+    std::vector<uint> children(uint i) const
+    {
+      std::vector<uint> c(bags_[i].num_children);
+      for (auto k = c.size(); k > 0; --k) {
+        c[k - 1] = i - 1;
+        i = first_[i - 1];
+      }
+      return c;
+    }
+
+    std::size_t bag_size(uint i) const
+    {
+      return bags_[i].vertex_end - bags_[i].vertex_begin;
+    }
+
+    // the vertices of bag i, sorted
+    vertex_range vertices(uint i) const
+    {
+      return vertex_range(vertices_.begin() + bags_[i].vertex_begin,
+                          vertices_.begin() + bags_[i].vertex_end);
+    }
+
+    edge_range edges(uint i) const
+    {
+      return edge_range(edges_.begin() + bags_[i].edge_begin,
+                        edges_.begin() + bags_[i].edge_end);
+    }
+
+    // edge k of the whole tree, bag i has edges [edge_begin, edge_end)
+    std::pair<uint, uint> const& edge(uint k) const { return edges_[k]; }
+
+    // the class of edge k, 0 unless set
+    unsigned int edge_class(uint k) const
+    {
+      return classes_.empty() ? 0 : classes_[k];
+    }
+
+    // set the class of each edge to f(a, b)
+    template<class F>
+    void set_edge_classes(F f)
+    {
+      classes_.resize(edges_.size());
+      for (std::size_t k = 0; k < edges_.size(); ++k)
+        classes_[k] = f(edges_[k].first, edges_[k].second);
+    }
+
+    // for each vertex of bag i, whether it is exhausted
+    exhausted_range exhausted(uint i) const
+    {
+      return exhausted_range(exhausted_.begin() + bags_[i].vertex_begin,
+                             exhausted_.begin() + bags_[i].vertex_end);
+    }
+
+    // position of vertex v in bag i
+    uint index(uint i, uint v) const
+    {
+      auto r = vertices(i);
+      auto it = std::lower_bound(r.begin(), r.end(), v);
+      assert(it != r.end() and *it == v);
+      return it - r.begin();
+    }
+
+    bool has(uint i, uint v) const
+    {
+      auto r = vertices(i);
+      return std::binary_search(r.begin(), r.end(), v);
+    }
+
+    std::size_t max_bag_size() const
+    {
+      std::size_t max = 0;
+      for (uint i = 0; i < size(); ++i)
+        max = std::max(max, bag_size(i));
+      return max;
+    }
+
+  private:
+    std::vector<bag> bags_;
+    std::vector<uint> first_;
+    std::vector<uint> vertices_;
+    edge_list edges_;
+    std::vector<unsigned int> classes_;
+    std::vector<char> exhausted_;
+  };
+}
+
+#endif
@@ -0,0 +1,326 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef TREE_DECOMPOSITION_SERIALIZATION_HPP
+#define TREE_DECOMPOSITION_SERIALIZATION_HPP
+
+#include "tree_decomposition.hpp"
+#include "../parse_graph.hpp"
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/properties.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ *  Saving and loading tree decompositions.
+ *
+ *  The binary format stores everything, per-bag edges included, so that
+ *  a decomposition can be reused as is. After a header ("LPTD", format
+ *  version, number of bags) bags follow in preorder, each one as
+ *
+ *    n, v_1 .. v_n, m, a_1 b_1 .. a_m b_m, number of children
+ *
+ *  all as native endian 32 bit unsigned integers.
+ *
+ *  The PACE .td text format only has bags and tree edges: the edges of
+ *  the graph are assigned to bags again when loading.
+ */
+
+namespace tree_decomposition {
+  namespace detail {
+    const char magic[4] = { 'L', 'P', 'T', 'D' };
+    const uint32_t version = 1;
+
+    inline void write(std::ostream& o, uint32_t x)
+    {
+      o.write(reinterpret_cast<const char*>(&x), sizeof(x));
+    }
+
+    inline uint32_t read(std::istream& i)
+    {
+      uint32_t x;
+      if (not i.read(reinterpret_cast<char*>(&x), sizeof(x)))
+        throw std::runtime_error("truncated tree decomposition");
+      return x;
+    }
+
+    // bags in preorder, without recursion
+    template<class F>
+    void preorder(tree_decomposition t, F f)
+    {
+      std::vector<bag_ptr> stack{t};
+      while (not stack.empty()) {
+        auto b = stack.back();
+        stack.pop_back();
+        f(b);
+        for (auto i = b->children.rbegin(); i != b->children.rend(); ++i)
+          stack.push_back(*i);
+      }
+    }
+
+    /*
+     *  throws unless t is a tree decomposition of g: every vertex is in a
+     *  bag, the bags of a vertex are connected, and the edges of the bags
+     *  are those of g, each between two vertices of its bag
+     */
+    template<class Graph>
+    void check(tree_decomposition t, Graph const& g)
+    {
+      using namespace boost;
+
+      auto const n = num_vertices(g);
+      // per vertex, the bags holding it whose parent does not: one if the
+      // bags of the vertex are connected
+      std::vector<uint> tops(n, 0);
+      std::vector<std::pair<uint, uint> > bag_edges;
+      std::vector<std::pair<bag_ptr, bag const*> > stack{{t, nullptr}};
+      while (not stack.empty()) {
+        auto b = stack.back().first;
+        auto parent = stack.back().second;
+        stack.pop_back();
+        for (auto v : b->vertices) {
+          if (v >= n)
+            throw std::runtime_error("tree decomposition and graph do not match");
+          if (parent == nullptr or not parent->vertices.has(v))
+            ++ tops[v];
+        }
+        for (auto e : b->edges) {
+          if (not b->vertices.has(e.first) or not b->vertices.has(e.second))
+            throw std::runtime_error("an edge of the tree decomposition is not in its bag");
+          bag_edges.push_back(std::minmax(e.first, e.second));
+        }
+        for (auto c : b->children)
+          stack.push_back(std::make_pair(c, b.get()));
+      }
+      for (uint v = 0; v < n; ++v) {
+        if (tops[v] == 0)
+          throw std::runtime_error("vertex not covered by the tree decomposition");
+        if (tops[v] > 1)
+          throw std::runtime_error("the bags of a vertex are not connected in the tree decomposition");
+      }
+
+      std::vector<std::pair<uint, uint> > graph_edges;
+      for (auto e : as_range(edges(g))) {
+        uint a = get(vertex_index, g, source(e, g));
+        uint b = get(vertex_index, g, target(e, g));
+        graph_edges.push_back(std::minmax(a, b));
+      }
+      std::sort(bag_edges.begin(), bag_edges.end());
+      std::sort(graph_edges.begin(), graph_edges.end());
+      if (bag_edges != graph_edges)
+        throw std::runtime_error("tree decomposition and graph do not match");
+    }
+  }
+
+  inline void save_binary(std::ostream& o, tree_decomposition t)
+  {
+    uint32_t num_bags = 0;
+    detail::preorder(t, [&](bag_ptr) { ++ num_bags; });
+
+    o.write(detail::magic, sizeof(detail::magic));
+    detail::write(o, detail::version);
+    detail::write(o, num_bags);
+    detail::preorder(t, [&](bag_ptr b) {
+      detail::write(o, b->vertices.size());
+      for (auto v : b->vertices)
+        detail::write(o, v);
+      detail::write(o, b->edges.size());
+      for (auto e : b->edges) {
+        detail::write(o, e.first);
+        detail::write(o, e.second);
+      }
+      detail::write(o, b->children.size());
+    });
+  }
+
+  inline tree_decomposition load_binary(std::istream& in)
+  {
+    char m[sizeof(detail::magic)];
+    if (not in.read(m, sizeof(m)) or not std::equal(m, m + sizeof(m), detail::magic))
+      throw std::runtime_error("not a tree decomposition file");
+    if (detail::read(in) != detail::version)
+      throw std::runtime_error("unsupported tree decomposition version");
+
+    auto num_bags = detail::read(in);
+    if (num_bags == 0)
+      throw std::runtime_error("empty tree decomposition");
+
+    bag_ptr root;
+    // bags still waiting for some of their children
+    std::vector<std::pair<bag_ptr, uint32_t> > stack;
+    for (uint32_t i = 0; i < num_bags; ++i) {
+      auto b = std::make_shared<bag>();
+      for (auto n = detail::read(in); n > 0; --n)
+        b->vertices.insert(detail::read(in));
+      for (auto n = detail::read(in); n > 0; --n) {
+        auto a = detail::read(in);
+        b->edges.push_back(std::make_pair(a, detail::read(in)));
+      }
+      auto num_children = detail::read(in);
+
+      if (i == 0) {
+        root = b;
+      } else {
+        if (stack.empty())
+          throw std::runtime_error("malformed tree decomposition");
+        stack.back().first->children.push_back(b);
+        -- stack.back().second;
+      }
+      if (num_children > 0)
+        stack.push_back(std::make_pair(b, num_children));
+      while (not stack.empty() and stack.back().second == 0)
+        stack.pop_back();
+    }
+    if (not stack.empty())
+      throw std::runtime_error("truncated tree decomposition");
+    return root;
+  }
+
+  // PACE .td, bags are numbered in preorder starting from 1
+  inline void save_td(std::ostream& o, tree_decomposition t,
+                      unsigned int num_vertices)
+  {
+    std::vector<bag_ptr> bags;
+    detail::preorder(t, [&](bag_ptr b) { bags.push_back(b); });
+
+    o << "s td " << bags.size() << " " << max_bag_size(t) << " "
+      << num_vertices << "\n";
+    for (std::size_t i = 0; i < bags.size(); ++i) {
+      o << "b " << i + 1;
+      for (auto v : bags[i]->vertices)
+        o << " " << v + 1;
+      o << "\n";
+    }
+    // in preorder each bag is followed by its subtree
+    std::vector<std::pair<std::size_t, std::size_t> > stack;
+    for (std::size_t i = 0; i < bags.size(); ++i) {
+      if (not stack.empty()) {
+        o << stack.back().first + 1 << " " << i + 1 << "\n";
+        -- stack.back().second;
+      }
+      if (not bags[i]->children.empty())
+        stack.push_back(std::make_pair(i, bags[i]->children.size()));
+      while (not stack.empty() and stack.back().second == 0)
+        stack.pop_back();
+    }
+  }
+
+  /*
+   *  root a PACE decomposition at its first bag and give each edge of g
+   *  to one of the bags containing both endpoints
+   */
+  template<class Graph>
+  tree_decomposition from_td(td_file const& td, Graph const& g)
+  {
+    using namespace boost;
+
+    if (td.bags.empty())
+      throw std::runtime_error("empty tree decomposition");
+    if (td.num_vertices != num_vertices(g))
+      throw std::runtime_error("tree decomposition and graph do not match");
+
+    std::vector<bag_ptr> bags(td.bags.size());
+    std::vector<std::vector<uint> > bags_of(td.num_vertices);
+    for (uint i = 0; i < bags.size(); ++i) {
+      bags[i] = std::make_shared<bag>();
+      for (auto v : td.bags[i]) {
+        bags[i]->vertices.insert(v);
+        bags_of[v].push_back(i);
+      }
+    }
+
+    for (auto e : as_range(edges(g))) {
+      uint a = get(vertex_index, g, source(e, g));
+      uint b = get(vertex_index, g, target(e, g));
+      auto i = std::find_if(bags_of[a].begin(), bags_of[a].end(),
+        [&](uint k) { return bags[k]->vertices.has(b); });
+      if (i == bags_of[a].end())
+        throw std::runtime_error("edge not covered by the tree decomposition");
+      bags[*i]->edges.push_back(std::make_pair(a, b));
+    }
+
+    std::vector<std::vector<uint> > adjacent(bags.size());
+    for (auto e : td.edges) {
+      adjacent[e.first].push_back(e.second);
+      adjacent[e.second].push_back(e.first);
+    }
+
+    // orient the tree away from the first bag
+    std::vector<bool> seen(bags.size(), false);
+    std::vector<uint> stack{0};
+    seen[0] = true;
+    while (not stack.empty()) {
+      auto i = stack.back();
+      stack.pop_back();
+      for (auto j : adjacent[i]) {
+        if (seen[j])
+          continue;
+        seen[j] = true;
+        bags[i]->children.push_back(bags[j]);
+        stack.push_back(j);
+      }
+    }
+    if (std::find(seen.begin(), seen.end(), false) != seen.end())
+      throw std::runtime_error("the tree decomposition is not connected");
+
+    detail::check(bags[0], g);
+    return bags[0];
+  }
+
+  inline bool is_td_filename(std::string const& filename)
+  {
+    return filename.size() >= 3 and
+      filename.compare(filename.size() - 3, 3, ".td") == 0;
+  }
+
+  inline void save(std::string const& filename, tree_decomposition t,
+                   unsigned int num_vertices)
+  {
+    std::ofstream o(filename, std::ios_base::binary);
+    if (not o.is_open())
+      throw std::runtime_error("cannot write " + filename);
+    if (is_td_filename(filename))
+      save_td(o, t, num_vertices);
+    else
+      save_binary(o, t);
+  }
+
+  template<class Graph>
+  tree_decomposition load(std::string const& filename, Graph const& g)
+  {
+    if (is_td_filename(filename))
+      return from_td(read_td(filename), g);
+
+    std::ifstream in(filename, std::ios_base::binary);
+    if (not in.is_open())
+      throw std::runtime_error("file " + filename + " not found");
+    auto t = load_binary(in);
+    detail::check(t, g);
+    return t;
+  }
+}
+
+#endif
@@ -58,7 +58,8 @@ namespace modular {
 	   , boost::equality_comparable< Zp
 	   > >
   {
-    static uint64_t M;
+    // one modulus per thread
+    static thread_local uint64_t M;
     uint64_t rep_;
 
   public:
@@ -131,7 +132,7 @@ namespace modular {
     }
   };
 
-  uint64_t Zp::M;
+  thread_local uint64_t Zp::M;
 }
 
 #endif
@@ -0,0 +1,34 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef ADDMUL_HPP
+#define ADDMUL_HPP
+
+/*
+ *  r += a * b. The weight types with a fused version (gmp::mpz_int,
+ *  polynomial) overload addmul and are found by argument dependent
+ *  lookup, everything else goes through a temporary product.
+ */
+
+template<class T>
+inline void addmul(T& r, T const& a, T const& b)
+{
+  r += a * b;
+}
+
+#endif
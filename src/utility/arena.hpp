@@ -0,0 +1,143 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/*
+ *  A monotonic arena: memory is handed out from chunks of growing size
+ *  and only given back, all at once, when the arena goes. A container
+ *  whose elements all die together, as the entries of a table do, takes
+ *  its memory from an arena_allocator and drops it in one go.
+ */
+
+class arena
+{
+  std::vector<void*> chunks_;
+  char* next_;
+  std::size_t left_;
+
+public:
+  static const std::size_t first_chunk = 1 << 12;
+  static const unsigned int doublings = 10;
+  static const std::size_t last_chunk = first_chunk << doublings;
+
+  arena() : next_(nullptr), left_(0) { }
+
+  arena(arena const&) = delete;
+  arena& operator=(arena const&) = delete;
+
+  ~arena()
+  {
+    for (auto p : chunks_)
+      ::operator delete(p);
+  }
+
+  void* allocate(std::size_t n, std::size_t align)
+  {
+    auto pad = (align - reinterpret_cast<std::uintptr_t>(next_) % align) % align;
+    if (pad + n > left_) {
+      // each chunk twice the previous one, up to last_chunk
+      auto const k = chunks_.size() < doublings ? chunks_.size() : doublings;
+      std::size_t size = first_chunk << k;
+      size = std::max(size, n + align);
+      chunks_.push_back(::operator new(size));
+      next_ = static_cast<char*>(chunks_.back());
+      left_ = size;
+      pad = (align - reinterpret_cast<std::uintptr_t>(next_) % align) % align;
+    }
+    auto p = next_ + pad;
+    next_ += pad + n;
+    left_ -= pad + n;
+    return p;
+  }
+};
+
+/*
+ *  Each allocator made from scratch has an arena of its own, shared by its
+ *  copies and rebinds: a container made empty gets a new arena, a moved
+ *  container keeps its own and shares it with what is left behind. Blocks
+ *  above a page, such as the buckets of a hash table that are given up as
+ *  it grows, come from the heap instead.
+ */
+template<class T>
+class arena_allocator
+{
+  template<class U>
+  friend class arena_allocator;
+
+  std::shared_ptr<arena> arena_;
+
+  static const std::size_t large = 1 << 12;
+
+public:
+  typedef T value_type;
+
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  arena_allocator() : arena_(std::make_shared<arena>()) { }
+
+  // declared so that a move copies too: a moved-from container still
+  // allocates, from the arena it now shares
+  arena_allocator(arena_allocator const& o) : arena_(o.arena_) { }
+  arena_allocator& operator=(arena_allocator const& o)
+  {
+    arena_ = o.arena_;
+    return *this;
+  }
+
+  template<class U>
+  arena_allocator(arena_allocator<U> const& o) : arena_(o.arena_) { }
+
+  // a copy of a container starts its own arena
+  arena_allocator select_on_container_copy_construction() const
+  {
+    return arena_allocator();
+  }
+
+  T* allocate(std::size_t n)
+  {
+    auto const bytes = n * sizeof(T);
+    if (bytes > large)
+      return static_cast<T*>(::operator new(bytes));
+    return static_cast<T*>(arena_->allocate(bytes, alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    if (n * sizeof(T) > large)
+      ::operator delete(p);
+  }
+
+  template<class U>
+  bool operator==(arena_allocator<U> const& o) const { return arena_ == o.arena_; }
+
+  template<class U>
+  bool operator!=(arena_allocator<U> const& o) const { return arena_ != o.arena_; }
+};
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef FIXED_UINT_HPP
+#define FIXED_UINT_HPP
+
+#include <boost/operators.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/*
+ *  Unsigned integers of N 64 bit limbs, kept on the stack. Counting only
+ *  needs sums and products of non negative numbers, so anything leaving
+ *  [0, 2^(64 N)) throws fixed::overflow and the caller can start again
+ *  with a wider type (see main.cpp).
+ */
+
+namespace fixed {
+  __extension__ typedef unsigned __int128 uint128_t;
+
+  struct overflow : std::overflow_error {
+    overflow() : std::overflow_error("fixed width integer overflow") { }
+  };
+
+  template<unsigned int N>
+  class fixed_uint
+    : boost::ring_operators< fixed_uint<N>
+    , boost::totally_ordered< fixed_uint<N>
+    > >
+  {
+    // least significant limb first
+    uint64_t limbs_[N];
+
+  public:
+    static const unsigned int bits = 64 * N;
+
+    fixed_uint()
+    {
+      std::fill(limbs_, limbs_ + N, 0);
+    }
+
+    template<class T>
+    fixed_uint(T n, typename std::enable_if<std::is_integral<T>::value>::type* = 0)
+    {
+      if (n < 0)
+        throw overflow();
+      std::fill(limbs_, limbs_ + N, 0);
+      limbs_[0] = n;
+    }
+
+    bool is_zero() const
+    {
+      return std::all_of(limbs_, limbs_ + N, [](uint64_t x) { return x == 0; });
+    }
+
+    fixed_uint& operator+=(fixed_uint const& rhs)
+    {
+      uint64_t carry = 0;
+      for (unsigned int i = 0; i < N; ++i) {
+        uint128_t s = uint128_t(limbs_[i]) + rhs.limbs_[i] + carry;
+        limbs_[i] = s;
+        carry = s >> 64;
+      }
+      if (carry)
+        throw overflow();
+      return *this;
+    }
+
+    fixed_uint& operator-=(fixed_uint const& rhs)
+    {
+      uint64_t borrow = 0;
+      for (unsigned int i = 0; i < N; ++i) {
+        uint128_t d = uint128_t(limbs_[i]) - rhs.limbs_[i] - borrow;
+        limbs_[i] = d;
+        borrow = (d >> 64) != 0;
+      }
+      if (borrow)
+        throw overflow();
+      return *this;
+    }
+
+    fixed_uint& operator*=(fixed_uint const& rhs)
+    {
+      // schoolbook, the high half of the product must be zero
+      uint64_t product[2 * N] = { };
+      for (unsigned int i = 0; i < N; ++i) {
+        if (limbs_[i] == 0)
+          continue;
+        uint64_t carry = 0;
+        for (unsigned int j = 0; j < N; ++j) {
+          uint128_t t = uint128_t(limbs_[i]) * rhs.limbs_[j] + product[i + j] + carry;
+          product[i + j] = t;
+          carry = t >> 64;
+        }
+        product[i + N] = carry;
+      }
+      for (unsigned int i = N; i < 2 * N; ++i) {
+        if (product[i])
+          throw overflow();
+      }
+      std::copy(product, product + N, limbs_);
+      return *this;
+    }
+
+    // only zero has an opposite
+    fixed_uint operator-() const
+    {
+      if (not is_zero())
+        throw overflow();
+      return *this;
+    }
+
+    friend bool operator==(fixed_uint const& a, fixed_uint const& b)
+    {
+      return std::equal(a.limbs_, a.limbs_ + N, b.limbs_);
+    }
+
+    friend bool operator<(fixed_uint const& a, fixed_uint const& b)
+    {
+      for (unsigned int i = N; i-- > 0; ) {
+        if (a.limbs_[i] != b.limbs_[i])
+          return a.limbs_[i] < b.limbs_[i];
+      }
+      return false;
+    }
+
+    std::string str() const
+    {
+      // peel off 19 decimal digits at a time
+      const uint64_t base = 10000000000000000000ull;
+      fixed_uint x(*this);
+      std::string s;
+      do {
+        uint128_t r = 0;
+        for (unsigned int i = N; i-- > 0; ) {
+          uint128_t d = (r << 64) | x.limbs_[i];
+          x.limbs_[i] = d / base;
+          r = d % base;
+        }
+        auto chunk = std::to_string(uint64_t(r));
+        if (not x.is_zero())
+          chunk.insert(0, 19 - chunk.size(), '0');
+        s.insert(0, chunk);
+      } while (not x.is_zero());
+      return s;
+    }
+
+    friend std::ostream& operator<<(std::ostream& o, fixed_uint const& x)
+    {
+      return o << x.str();
+    }
+  };
+
+  typedef fixed_uint<1> uint64;
+  typedef fixed_uint<2> uint128;
+  typedef fixed_uint<4> uint256;
+}
+
+#endif
@@ -19,26 +19,109 @@
 #ifndef GMP_HPP
 #define GMP_HPP
 
+#include <cstddef>
 #include <iosfwd>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 namespace gmp {
 	#include "gmp.h"
 
+	// The values released by mpz_int keep their limbs for the next ones
+	// to be created, so that temporaries do not go back to malloc. There
+	// is one pool per thread. Values living longer than the pool of their
+	// thread, statics or thread locals destroyed after it, go straight to
+	// mpz_init and mpz_clear.
+	class mpz_pool {
+		std::vector<__mpz_struct> free_;
+
+		// a trivial thread local, usable while the pool is being destroyed
+		// and after
+		static bool& gone() {
+			static thread_local bool flag = false;
+			return flag;
+		}
+
+		static mpz_pool& local() {
+			static thread_local mpz_pool pool;
+			return pool;
+		}
+
+	public:
+		static const std::size_t capacity = 1024;
+
+		mpz_pool() { free_.reserve(capacity); }
+
+		~mpz_pool() {
+			gone() = true;
+			for (auto& x : free_)
+				mpz_clear(&x);
+		}
+
+		// an initialised value, equal to zero
+		void take(mpz_ptr p) {
+			if (free_.empty()) {
+				mpz_init(p);
+			} else {
+				*p = free_.back();
+				free_.pop_back();
+				mpz_set_ui(p, 0);
+			}
+		}
+
+		void give(mpz_ptr p) {
+			if (free_.size() < capacity and p->_mp_alloc > 0)
+				free_.push_back(*p);
+			else
+				mpz_clear(p);
+		}
+
+		// from the pool of this thread, if it is still there
+		static void acquire(mpz_ptr p) {
+			if (gone())
+				mpz_init(p);
+			else
+				local().take(p);
+		}
+
+		static void release(mpz_ptr p) {
+			if (gone())
+				mpz_clear(p);
+			else
+				local().give(p);
+		}
+	};
+
 	class mpz_int {
 		mpz_t m_data;
 	public:
 		// 5.1 Initialization Functions
 
-		mpz_int()   { mpz_init(m_data); }
-		~mpz_int() { mpz_clear(m_data); }
+		mpz_int()   { mpz_pool::acquire(m_data); }
+		~mpz_int() { mpz_pool::release(m_data); }
 
 		mpz_int(mpz_int const& o) {
-			mpz_init_set(m_data, o.m_data);
+			mpz_pool::acquire(m_data);
+			mpz_set(m_data, o.m_data);
+		}
+
+		// mpz_init does not allocate, the moved from value is a valid zero
+		mpz_int(mpz_int&& o) noexcept {
+			mpz_init(m_data);
+			mpz_swap(m_data, o.m_data);
 		}
 
+		// 5.2 Assignment Functions
+
 		mpz_int& operator=(mpz_int const& o) {
-			mpz_init_set(m_data, o.m_data);
+			mpz_set(m_data, o.m_data);
+			return *this;
+		}
+
+		mpz_int& operator=(mpz_int&& o) noexcept {
+			mpz_swap(m_data, o.m_data);
 			return *this;
 		}
 
@@ -46,22 +129,28 @@ namespace gmp {
 
 		template<typename T>
 		mpz_int(T op, typename std::enable_if<std::is_unsigned<T>::value >::type* = 0) {
-			mpz_init_set_ui(m_data, op);
+			mpz_pool::acquire(m_data);
+			mpz_set_ui(m_data, op);
 		}
 
 		template<typename T>
 		mpz_int(T op, typename std::enable_if<std::is_signed<T>::value >::type* = 0) {
-			mpz_init_set_si(m_data, op);
+			mpz_pool::acquire(m_data);
+			mpz_set_si(m_data, op);
 		}
 
 		mpz_int(double op) {
-			mpz_init_set_d(m_data, op);
+			mpz_pool::acquire(m_data);
+			mpz_set_d(m_data, op);
 		}
 
 		mpz_int(std::string const& op, int base = 10) {
-			int ret = mpz_init_set_str(m_data, op.c_str(), base);
-			if (ret == -1)
-				throw("mpz_init_set_str");
+			mpz_pool::acquire(m_data);
+			int ret = mpz_set_str(m_data, op.c_str(), base);
+			if (ret == -1) {
+				mpz_pool::release(m_data);
+				throw std::invalid_argument("mpz_set_str: not a number in base " + std::to_string(base));
+			}
 		}
 
 		// 5.4 Conversion Functions
@@ -196,6 +285,11 @@ namespace gmp {
 			return *this;
 		}
 	
+		// r += a * b, without a temporary
+		friend void addmul(mpz_int& r, mpz_int const& a, mpz_int const& b) {
+			mpz_addmul(r.m_data, a.m_data, b.m_data);
+		}
+
 		// 5.6 Division Functions
 
 		mpz_int operator/(mpz_int const& rhs) {
@@ -264,6 +358,27 @@ namespace gmp {
 
 		// TODO later
 
+		// 5.14 Integer Import and Export
+
+		// a sign byte, then the absolute value most significant byte first
+		std::string bytes() const {
+			std::size_t count = (mpz_sizeinbase(m_data, 2) + 7) / 8;
+			std::string s(1 + count, '\0');
+			s[0] = mpz_sgn(m_data) < 0 ? '-' : '+';
+			mpz_export(&s[1], &count, 1, 1, 1, 0, m_data);
+			s.resize(1 + count);
+			return s;
+		}
+
+		static mpz_int from_bytes(char const* p, std::size_t n) {
+			mpz_int r;
+			if (n > 1)
+				mpz_import(r.m_data, n - 1, 1, 1, 1, 0, p + 1);
+			if (p[0] == '-')
+				mpz_neg(r.m_data, r.m_data);
+			return r;
+		}
+
 		// friend functions
 
 		friend mpz_int modinv(mpz_int const& a, mpz_int const& b)
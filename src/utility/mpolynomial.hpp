@@ -0,0 +1,470 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef MPOLYNOMIAL_HPP_
+#define MPOLYNOMIAL_HPP_
+
+#include "addmul.hpp"
+
+#include <boost/operators.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+ *  Sparse polynomials in up to four variables x, y, z, w. A monomial is
+ *  packed in a 64 bit key, 16 bits per exponent, and the terms are kept
+ *  sorted by key in a single vector. Multiplying by a variable adds a
+ *  constant to every key, which keeps them sorted. An exponent that does
+ *  not fit in 16 bits throws exponent_overflow.
+ *
+ *  In the fusions of the transfer one factor of addmul is usually a
+ *  single term, and the product is the other one moved along. Otherwise
+ *  the products are accumulated in a dense array over the box of the
+ *  exponents of the result, when that box is not much larger than the
+ *  number of products, and reading the array in order gives the terms
+ *  sorted. Failing that, the products are sorted by monomial.
+ */
+
+struct exponent_overflow : std::overflow_error {
+  exponent_overflow() : std::overflow_error("an exponent exceeds 16 bits") { }
+};
+
+template<typename T>
+class mpolynomial
+  : boost::ring_operators1< mpolynomial<T>
+  , boost::ring_operators2< mpolynomial<T>, T
+  , boost::equality_comparable< mpolynomial<T>
+  > > >
+{
+public:
+  typedef uint64_t monomial;
+  typedef std::pair<monomial, T> term;
+
+  static const unsigned int num_variables = 4;
+  static const unsigned int bits = 16;
+
+  static unsigned int exponent(monomial m, unsigned int k)
+  {
+    return (m >> (bits * k)) & ((monomial(1) << bits) - 1);
+  }
+
+  static const unsigned int max_exponent = (1u << bits) - 1;
+
+  static unsigned int degree(monomial m)
+  {
+    unsigned int d = 0;
+    for (unsigned int k = 0; k < num_variables; ++k)
+      d += exponent(m, k);
+    return d;
+  }
+
+private:
+  /// non zero terms, sorted by monomial
+  std::vector<term> impl_;
+
+  // the smallest and the largest exponent of each variable, for a non
+  // zero polynomial
+  void exponent_range(unsigned int lo[], unsigned int hi[]) const
+  {
+    for (unsigned int k = 0; k < num_variables; ++k) {
+      lo[k] = max_exponent;
+      hi[k] = 0;
+    }
+    for (auto const& t : impl_) {
+      for (unsigned int k = 0; k < num_variables; ++k) {
+        lo[k] = std::min(lo[k], exponent(t.first, k));
+        hi[k] = std::max(hi[k], exponent(t.first, k));
+      }
+    }
+  }
+
+  void normalize()
+  {
+    impl_.erase(std::remove_if(impl_.begin(), impl_.end(),
+      [](term const& t) { return t.second == 0; }), impl_.end());
+  }
+
+  template<class F>
+  void merge(mpolynomial<T> const& rhs, F f)
+  {
+    // the common case in the transfer: the monomials of rhs are already
+    // there, the coefficients are updated in place
+    auto i = impl_.begin();
+    auto j = rhs.impl_.begin();
+    for (; j != rhs.impl_.end(); ++j) {
+      while (i != impl_.end() and i->first < j->first)
+        ++ i;
+      if (i == impl_.end() or i->first != j->first)
+        break;
+      f((i++)->second, j->second);
+    }
+    if (j == rhs.impl_.end()) {
+      normalize();
+      return;
+    }
+
+    // otherwise make room for the monomials that are missing and merge
+    // from the back: the terms are moved at most once, with no new vector
+    std::size_t missing = 0;
+    for (auto k = i, l = j; l != rhs.impl_.end(); ++l) {
+      while (k != impl_.end() and k->first < l->first)
+        ++ k;
+      missing += k == impl_.end() or k->first != l->first;
+    }
+    auto const start = i - impl_.begin();
+    auto const old_size = impl_.size();
+    auto const first_rhs = j - rhs.impl_.begin();
+    impl_.resize(old_size + missing);
+    auto out = impl_.end();
+    auto x = impl_.begin() + old_size;  // one past the last old term left
+    auto y = rhs.impl_.end();
+    while (y != rhs.impl_.begin() + first_rhs) {
+      if (x != impl_.begin() + start and (x - 1)->first > (y - 1)->first) {
+        *--out = std::move(*--x);
+      } else if (x != impl_.begin() + start and (x - 1)->first == (y - 1)->first) {
+        *--out = std::move(*--x);
+        f(out->second, (--y)->second);
+      } else {
+        --out;
+        out->first = (--y)->first;
+        out->second = T(0);
+        f(out->second, y->second);
+      }
+    }
+    normalize();
+  }
+
+public:
+  explicit mpolynomial(const T& a = T(0))
+  {
+    if (not (a == 0))
+      impl_.push_back(term(0, a));
+  }
+
+  // conversions
+  template<typename T2>
+  friend class mpolynomial;
+
+  template<class T2>
+  explicit mpolynomial(T2 const& a)
+    : mpolynomial(T(a))
+  {
+  }
+
+  // from terms already sorted by monomial
+  explicit mpolynomial(std::vector<term> terms)
+    : impl_(std::move(terms))
+  {
+    normalize();
+  }
+
+  template<class T2>
+  explicit mpolynomial(mpolynomial<T2> const& rhs)
+  {
+    for (auto const& t : rhs.impl_)
+      impl_.push_back(term(t.first, T(t.second)));
+    normalize();
+  }
+
+  // iterators over the terms
+  typename std::vector<term>::const_iterator begin() const { return impl_.begin(); }
+  typename std::vector<term>::const_iterator end() const { return impl_.end(); }
+
+  bool operator==(const mpolynomial<T>& rhs) const
+  {
+    return impl_ == rhs.impl_;
+  }
+
+  /// arithmetic
+  mpolynomial<T>& operator+=(const T& rhs)
+  {
+    return *this += mpolynomial<T>(rhs);
+  }
+
+  mpolynomial<T>& operator-=(const T& rhs)
+  {
+    return *this -= mpolynomial<T>(rhs);
+  }
+
+  mpolynomial<T>& operator*=(const T& rhs)
+  {
+    for (auto& t : impl_)
+      t.second *= rhs;
+    normalize();
+    return *this;
+  }
+
+  mpolynomial<T>& operator+=(const mpolynomial<T>& rhs)
+  {
+    merge(rhs, [](T& a, T const& b) { a += b; });
+    return *this;
+  }
+
+  // adding to zero, as for a new entry of a table, takes the terms
+  mpolynomial<T>& operator+=(mpolynomial<T>&& rhs)
+  {
+    if (impl_.empty())
+      impl_.swap(rhs.impl_);
+    else
+      *this += static_cast<mpolynomial<T> const&>(rhs);
+    return *this;
+  }
+
+  mpolynomial<T>& operator-=(const mpolynomial<T>& rhs)
+  {
+    merge(rhs, [](T& a, T const& b) { a -= b; });
+    return *this;
+  }
+
+  template<class U>
+  friend void addmul(mpolynomial<U>& r, mpolynomial<U> const& a, mpolynomial<U> const& b);
+
+  mpolynomial<T>& operator*=(const mpolynomial<T>& rhs)
+  {
+    if (impl_.empty() or rhs.impl_.empty()) {
+      impl_.clear();
+      return *this;
+    }
+    unsigned int lo[num_variables], hi[num_variables];
+    unsigned int rhs_lo[num_variables], rhs_hi[num_variables];
+    exponent_range(lo, hi);
+    rhs.exponent_range(rhs_lo, rhs_hi);
+    for (unsigned int k = 0; k < num_variables; ++k) {
+      if (hi[k] + rhs_hi[k] > max_exponent)
+        throw exponent_overflow();
+    }
+
+    // sort the pairs of terms by the monomial of their product, then
+    // compute each coefficient of the product in place
+    std::vector<std::pair<monomial, std::size_t> > pairs;
+    pairs.reserve(impl_.size() * rhs.impl_.size());
+    for (std::size_t i = 0; i < impl_.size(); ++i) {
+      for (std::size_t j = 0; j < rhs.impl_.size(); ++j)
+        pairs.push_back(std::make_pair(impl_[i].first + rhs.impl_[j].first,
+                                       i * rhs.impl_.size() + j));
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    // coefficients are not moved around, make room first
+    std::size_t size = 0;
+    for (std::size_t k = 0; k < pairs.size(); ++k)
+      size += k == 0 or pairs[k].first != pairs[k - 1].first;
+    std::vector<term> product;
+    product.reserve(size);
+    for (auto const& p : pairs) {
+      auto const& a = impl_[p.second / rhs.impl_.size()];
+      auto const& b = rhs.impl_[p.second % rhs.impl_.size()];
+      if (product.empty() or product.back().first != p.first)
+        product.push_back(term(p.first, a.second * b.second));
+      else
+        product.back().second += a.second * b.second;
+    }
+    impl_.swap(product);
+    normalize();
+    return *this;
+  }
+
+  // multiply by the k-th variable
+  mpolynomial<T>& mul_var(unsigned int k)
+  {
+    assert(k < num_variables);
+    auto const step = monomial(1) << (bits * k);
+    for (auto& t : impl_) {
+      if (exponent(t.first, k) == max_exponent)
+        throw exponent_overflow();
+      t.first += step;
+    }
+    return *this;
+  }
+
+  const mpolynomial<T> operator-() const
+  {
+    mpolynomial<T> y(*this);
+    for (auto& t : y.impl_)
+      t.second = -t.second;
+    return y;
+  }
+};
+
+// r += a * b
+template<class T>
+void addmul(mpolynomial<T>& r, mpolynomial<T> const& a, mpolynomial<T> const& b)
+{
+  typedef mpolynomial<T> P;
+  typedef typename P::monomial monomial;
+  auto const n = P::num_variables;
+
+  if (a.impl_.empty() or b.impl_.empty())
+    return;
+
+  unsigned int lo[n], hi[n], b_lo[n], b_hi[n];
+  a.exponent_range(lo, hi);
+  b.exponent_range(b_lo, b_hi);
+  for (unsigned int k = 0; k < n; ++k) {
+    lo[k] += b_lo[k];
+    hi[k] += b_hi[k];
+    if (hi[k] > P::max_exponent)
+      throw exponent_overflow();
+  }
+
+  // a single term, as for the weights of the states fused in a lattice,
+  // moves the other factor: the keys stay sorted
+  if (a.impl_.size() == 1 or b.impl_.size() == 1) {
+    auto const& one = (a.impl_.size() == 1 ? a : b).impl_.front();
+    auto const& other = a.impl_.size() == 1 ? b : a;
+    P product;
+    product.impl_.reserve(other.impl_.size());
+    for (auto const& t : other.impl_)
+      product.impl_.push_back(typename P::term(t.first + one.first, t.second * one.second));
+    product.normalize();
+    r += std::move(product);
+    return;
+  }
+
+  // the box of the exponents of r and of the product
+  for (auto const& t : r.impl_) {
+    for (unsigned int k = 0; k < n; ++k) {
+      lo[k] = std::min(lo[k], P::exponent(t.first, k));
+      hi[k] = std::max(hi[k], P::exponent(t.first, k));
+    }
+  }
+
+  // offsets in the box, the last variable varying slowest as in the keys
+  auto const products = a.impl_.size() * b.impl_.size();
+  auto const largest = 4 * (products + r.impl_.size());
+  std::size_t stride[n], size = 1;
+  for (unsigned int k = 0; k < n; ++k) {
+    stride[k] = size;
+    size *= hi[k] - lo[k] + 1;
+    if (size > largest) {
+      r += a * b;
+      return;
+    }
+  }
+
+  // negative for some terms of a, never once the term of b is added
+  auto offset = [&](monomial m, unsigned int const base[]) {
+    std::ptrdiff_t x = 0;
+    for (unsigned int k = 0; k < n; ++k)
+      x += (std::ptrdiff_t(P::exponent(m, k)) - base[k]) * std::ptrdiff_t(stride[k]);
+    return x;
+  };
+  unsigned int const zero[n] = { };
+
+  // zero between uses, one per thread
+  static thread_local std::vector<T> box;
+  if (box.size() < size)
+    box.resize(size, T(0));
+
+  // back to zero if a product overflows, or the next call adds to the rest
+  try {
+    for (auto& t : r.impl_)
+      box[offset(t.first, lo)] = std::move(t.second);
+    std::vector<std::ptrdiff_t> b_offsets;
+    b_offsets.reserve(b.impl_.size());
+    for (auto const& t : b.impl_)
+      b_offsets.push_back(offset(t.first, zero));
+    for (auto const& s : a.impl_) {
+      auto const x = offset(s.first, lo);
+      for (std::size_t j = 0; j < b.impl_.size(); ++j)
+        addmul(box[x + b_offsets[j]], s.second, b.impl_[j].second);
+    }
+
+    // the monomial of each offset, in the order of the keys
+    std::vector<typename P::term> terms;
+    terms.reserve(std::min(size, products + r.impl_.size()));
+    for (std::size_t x = 0; x < size; ++x) {
+      if (box[x] == 0)
+        continue;
+      monomial m = 0;
+      auto rest = x;
+      for (unsigned int k = n; k-- > 0; ) {
+        m |= monomial(lo[k] + rest / stride[k]) << (P::bits * k);
+        rest %= stride[k];
+      }
+      terms.push_back(typename P::term(m, std::move(box[x])));
+      box[x] = T(0);
+    }
+    r.impl_.swap(terms);
+  } catch (...) {
+    std::fill(box.begin(), box.begin() + size, T(0));
+    throw;
+  }
+}
+
+template<class T>
+mpolynomial<T> mul_var(mpolynomial<T> p, unsigned int k)
+{
+  return std::move(p.mul_var(k));
+}
+
+// terms by total degree, then by decreasing powers of x, y, z
+template<class T>
+std::ostream& operator<<(std::ostream& o, const mpolynomial<T>& p)
+{
+  typedef typename mpolynomial<T>::term term;
+  typedef mpolynomial<T> P;
+  std::vector<term> terms(p.begin(), p.end());
+  std::sort(terms.begin(), terms.end(), [](term const& a, term const& b) {
+    auto da = P::degree(a.first), db = P::degree(b.first);
+    if (da != db)
+      return da < db;
+    for (unsigned int k = 0; k < P::num_variables; ++k) {
+      if (P::exponent(a.first, k) != P::exponent(b.first, k))
+        return P::exponent(a.first, k) > P::exponent(b.first, k);
+    }
+    return false;
+  });
+
+  const char variables[] = "xyzw";
+  bool first = true;
+  for (auto const& t : terms) {
+    auto c = t.second;
+    if (c < 0) {
+      o << "- ";
+      c = -c;
+    } else if (not first) {
+      o << "+ ";
+    }
+    first = false;
+    if (c != 1 or t.first == 0) {
+      o << c << " ";
+    }
+    for (unsigned int k = 0; k < P::num_variables; ++k) {
+      auto e = P::exponent(t.first, k);
+      if (e == 0)
+        continue;
+      o << variables[k];
+      if (e > 1)
+        o << "^" << e;
+      o << " ";
+    }
+  }
+  if (first)
+    o << "0 ";
+  return o;
+}
+
+#endif // MPOLYNOMIAL_HPP_
@@ -19,6 +19,8 @@
 #ifndef POLYNOMIAL_HPP_
 #define POLYNOMIAL_HPP_
 
+#include "addmul.hpp"
+
 #include <boost/operators.hpp>
 
 #include <iosfwd>
@@ -35,6 +37,9 @@ class polynomial
   /// Coefficients { c_0; ...; c_n } :
   std::vector<T> impl_;
 
+  template<class U>
+  friend void addmul(polynomial<U>& r, polynomial<U> const& a, polynomial<U> const& b);
+
   /// remove leading zero coefficients
   void normalize()
   {
@@ -219,6 +224,25 @@ public:
 
 };
 
+// r += a * b, accumulating each product of coefficients in place
+template<class T>
+void addmul(polynomial<T>& r, polynomial<T> const& a, polynomial<T> const& b)
+{
+  r.order(std::max(r.order(), a.order() + b.order()));
+  for (std::size_t i = 0; i <= a.order(); i++) {
+    for (std::size_t j = 0; j <= b.order(); j++)
+      addmul(r.impl_[i + j], a.impl_[i], b.impl_[j]);
+  }
+  r.normalize();
+}
+
+// multiply by the k-th variable, all of them being x here
+template<class T>
+polynomial<T> mul_var(polynomial<T> const& p, unsigned int)
+{
+  return p << 1;
+}
+
 template<class T>
 std::ostream& operator<<(std::ostream& o, const polynomial<T>& p)
 {
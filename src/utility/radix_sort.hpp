@@ -0,0 +1,124 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef RADIX_SORT_HPP
+#define RADIX_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+/*
+ *  Least significant digit radix sort of n byte strings of the same width,
+ *  packed one after the other. Each pass is a counting sort on one column
+ *  and can be split among threads: each thread counts the digits of its
+ *  own slice, then moves its slice to the places the counts of all the
+ *  slices give it.
+ */
+
+namespace radix {
+
+  // the number of threads a sort may use, for the calling thread
+  inline unsigned int& num_threads()
+  {
+    static thread_local unsigned int n = 1;
+    return n;
+  }
+
+  // runs f(0) .. f(k - 1), each in its own thread but the first
+  template<class F>
+  void parallel_for(unsigned int k, F f)
+  {
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < k; ++t)
+      threads.emplace_back(f, t);
+    f(0);
+    for (auto& t : threads)
+      t.join();
+  }
+
+  // below this many strings per thread, threads are not worth it
+  const std::size_t min_slice = 1 << 16;
+
+  /*
+   *  The order of the n strings in rows, as indices, by lexicographic
+   *  order of the bytes. Equal strings keep their order.
+   */
+  inline std::vector<uint32_t>
+  sort(std::vector<uint8_t> const& rows, std::size_t n, std::size_t width)
+  {
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (n < 64) {
+      std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return std::lexicographical_compare(
+          rows.begin() + a * width, rows.begin() + (a + 1) * width,
+          rows.begin() + b * width, rows.begin() + (b + 1) * width);
+      });
+      return order;
+    }
+
+    unsigned int const k = std::max<std::size_t>(1,
+      std::min<std::size_t>(num_threads(), n / min_slice));
+    auto slice = [&](unsigned int t) { return n * t / k; };
+
+    std::vector<uint32_t> next(n);
+    std::vector<std::size_t> counts(256 * k);
+    for (auto p = width; p-- > 0; ) {
+      std::fill(counts.begin(), counts.end(), 0);
+      parallel_for(k, [&](unsigned int t) {
+        auto c = &counts[256 * t];
+        for (auto i = slice(t); i < slice(t + 1); ++i)
+          ++ c[rows[order[i] * width + p]];
+      });
+
+      // a column with a single digit leaves the order as it is
+      std::size_t largest = 0;
+      for (unsigned int d = 0; d < 256; ++d) {
+        std::size_t total = 0;
+        for (unsigned int t = 0; t < k; ++t)
+          total += counts[256 * t + d];
+        largest = std::max(largest, total);
+      }
+      if (largest == n)
+        continue;
+
+      // where the digits of each slice go, digit by digit then slice by slice
+      std::size_t start = 0;
+      for (unsigned int d = 0; d < 256; ++d) {
+        for (unsigned int t = 0; t < k; ++t) {
+          auto const c = counts[256 * t + d];
+          counts[256 * t + d] = start;
+          start += c;
+        }
+      }
+      parallel_for(k, [&](unsigned int t) {
+        auto c = &counts[256 * t];
+        for (auto i = slice(t); i < slice(t + 1); ++i)
+          next[c[rows[order[i] * width + p]]++] = order[i];
+      });
+      order.swap(next);
+    }
+    return order;
+  }
+}
+
+#endif
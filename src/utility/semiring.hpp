@@ -0,0 +1,223 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SEMIRING_HPP
+#define SEMIRING_HPP
+
+#include "polynomial.hpp"
+
+#include <boost/operators.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+/*
+ *  Weights answering less than the counts do, most in one machine word. The
+ *  operators only add weights (+=), multiply them (addmul) and multiply
+ *  them by the variable x of an edge (mul_var), and they make the weight
+ *  of the empty state as Weight(1): as for the integers, Weight(n) is the
+ *  sum of n ones and Weight() is zero.
+ */
+
+/*
+ *  The max-plus (tropical) semiring on lengths: adding is taking the
+ *  longest, multiplying is adding the lengths and x is the length 1. The
+ *  weight of a table is the number of edges of its longest path.
+ */
+class max_plus
+  : boost::addable< max_plus
+  , boost::multipliable< max_plus
+  , boost::totally_ordered< max_plus
+  > > >
+{
+  int64_t length_;
+
+  static const int64_t none = std::numeric_limits<int64_t>::min();
+
+public:
+  max_plus() : length_(none) { }
+
+  max_plus(unsigned int n) : length_(n == 0 ? none : 0) { }
+
+  // the weight of a path of k edges
+  static max_plus length(int64_t k)
+  {
+    max_plus w;
+    w.length_ = k;
+    return w;
+  }
+
+  bool is_zero() const { return length_ == none; }
+  int64_t value() const { return length_; }
+
+  max_plus& operator+=(max_plus const& rhs)
+  {
+    if (rhs.length_ > length_)
+      length_ = rhs.length_;
+    return *this;
+  }
+
+  max_plus& operator*=(max_plus const& rhs)
+  {
+    if (is_zero() or rhs.is_zero())
+      length_ = none;
+    else
+      length_ += rhs.length_;
+    return *this;
+  }
+
+  bool operator==(max_plus const& rhs) const
+  {
+    return length_ == rhs.length_;
+  }
+
+  // shorter, zero coming first
+  bool operator<(max_plus const& rhs) const
+  {
+    return length_ < rhs.length_;
+  }
+
+  // all the edges have length 1, whatever their class
+  friend max_plus mul_var(max_plus const& w, unsigned int)
+  {
+    return w * length(1);
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, max_plus const& w)
+  {
+    if (w.is_zero())
+      return o << "none";
+    return o << w.length_;
+  }
+};
+
+/*
+ *  The longest length together with the number of paths of that length:
+ *  adding keeps the longer of the two, adding up the counts if they are
+ *  equally long, multiplying adds the lengths and multiplies the counts.
+ *  These are the weights the paths are drawn with, see sample.hpp.
+ */
+template<class Integer>
+class longest_count
+  : boost::addable< longest_count<Integer>
+  , boost::multipliable< longest_count<Integer>
+  , boost::equality_comparable< longest_count<Integer>
+  > > >
+{
+  max_plus length_;
+  Integer count_;
+
+public:
+  typedef Integer integer_type;
+
+  longest_count() : length_(), count_(0u) { }
+
+  longest_count(unsigned int n) : length_(n), count_(n) { }
+
+  max_plus const& length() const { return length_; }
+  Integer const& count() const { return count_; }
+
+  longest_count& operator+=(longest_count const& rhs)
+  {
+    if (length_ < rhs.length_)
+      *this = rhs;
+    else if (length_ == rhs.length_)
+      count_ += rhs.count_;
+    return *this;
+  }
+
+  longest_count& operator*=(longest_count const& rhs)
+  {
+    length_ *= rhs.length_;
+    count_ *= rhs.count_;
+    return *this;
+  }
+
+  bool operator==(longest_count const& rhs) const
+  {
+    return length_ == rhs.length_ and count_ == rhs.count_;
+  }
+
+  friend longest_count mul_var(longest_count w, unsigned int c)
+  {
+    w.length_ = mul_var(w.length_, c);
+    return w;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, longest_count const& w)
+  {
+    return o << w.count_ << " of length " << w.length_;
+  }
+};
+
+/*
+ *  The boolean semiring: adding is or, multiplying is and. As the
+ *  coefficients of a polynomial, they tell which lengths occur.
+ */
+class boolean
+  : boost::addable< boolean
+  , boost::multipliable< boolean
+  , boost::equality_comparable< boolean
+  > > >
+{
+  bool value_;
+
+public:
+  boolean() : value_(false) { }
+
+  boolean(unsigned int n) : value_(n != 0) { }
+
+  explicit operator bool() const { return value_; }
+
+  boolean& operator+=(boolean const& rhs)
+  {
+    value_ = value_ or rhs.value_;
+    return *this;
+  }
+
+  boolean& operator*=(boolean const& rhs)
+  {
+    value_ = value_ and rhs.value_;
+    return *this;
+  }
+
+  bool operator==(boolean const& rhs) const
+  {
+    return value_ == rhs.value_;
+  }
+};
+
+// the lengths that occur, as the terms of a polynomial with unit coefficients
+inline std::ostream& operator<<(std::ostream& o, polynomial<boolean> const& p)
+{
+  for (auto i = 0u; i <= p.order(); i++) {
+    if (not p[i])
+      continue;
+    if (i > 0)
+      o << "+ x";
+    else
+      o << "1";
+    if (i > 1)
+      o << "^" << i;
+    o << " ";
+  }
+  return o;
+}
+
+#endif
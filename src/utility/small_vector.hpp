@@ -0,0 +1,223 @@
+/*
+ *  Created by Andrea Bedini on 18/Oct/2026.
+ *  Copyright 2026 Andrea Bedini <andrea@andreabedini.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include <boost/functional/hash.hpp>
+#include <boost/operators.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+/*
+ *  A vector of a trivial type whose size is set when it is made, keeping
+ *  up to N elements inline: making, copying and dropping one of those
+ *  never allocates, and a copy is a copy of the whole block. A longer one
+ *  has its elements on the heap.
+ */
+
+template<class T, std::size_t N>
+class small_vector
+  : boost::totally_ordered< small_vector<T, N> >
+{
+  static_assert(std::is_trivial<T>::value, "the elements are copied as a block");
+  static_assert(N < 255, "the size is kept in a byte");
+
+  struct heap_block {
+    T* data;
+    std::size_t size;
+  };
+  static_assert(sizeof(heap_block) <= N * sizeof(T), "the heap block takes the room of the elements");
+
+  // unused inline elements are zero, so that copies copy defined values
+  union {
+    T inline_[N];
+    heap_block heap_;
+  };
+  // the size when the elements are inline, on_heap otherwise
+  unsigned char tag_;
+
+  static const unsigned char on_heap = 255;
+
+  bool is_inline() const { return tag_ != on_heap; }
+
+  // room for n elements equal to zero, whatever was there is not released
+  void init(std::size_t n)
+  {
+    if (n <= N) {
+      std::fill(inline_, inline_ + N, T());
+      tag_ = n;
+    } else {
+      if (n > max_size())
+        throw std::length_error("small_vector: too many elements");
+      heap_.data = new T[n]();
+      heap_.size = n;
+      tag_ = on_heap;
+    }
+  }
+
+  void copy(small_vector const& o)
+  {
+    if (o.is_inline()) {
+      std::copy(o.inline_, o.inline_ + N, inline_);
+      tag_ = o.tag_;
+    } else {
+      init(o.size());
+      std::copy(o.begin(), o.end(), begin());
+    }
+  }
+
+  void steal(small_vector& o)
+  {
+    if (o.is_inline()) {
+      std::copy(o.inline_, o.inline_ + N, inline_);
+      tag_ = o.tag_;
+    } else {
+      heap_ = o.heap_;
+      tag_ = on_heap;
+      o.init(0);
+    }
+  }
+
+  void release()
+  {
+    if (not is_inline())
+      delete[] heap_.data;
+  }
+
+public:
+  typedef T value_type;
+  typedef T& reference;
+  typedef T const& const_reference;
+  typedef T* iterator;
+  typedef T const* const_iterator;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  small_vector() { init(0); }
+
+  explicit small_vector(size_type n, T const& x = T())
+  {
+    init(n);
+    std::fill(begin(), end(), x);
+  }
+
+  template<class InputIterator>
+  small_vector(InputIterator first, InputIterator last,
+               typename std::enable_if<not std::is_integral<InputIterator>::value>::type* = 0)
+  {
+    init(std::distance(first, last));
+    std::copy(first, last, begin());
+  }
+
+  small_vector(small_vector const& o) { copy(o); }
+  small_vector(small_vector&& o) noexcept { steal(o); }
+
+  small_vector& operator=(small_vector const& o)
+  {
+    if (this != &o) {
+      release();
+      copy(o);
+    }
+    return *this;
+  }
+
+  small_vector& operator=(small_vector&& o) noexcept
+  {
+    if (this != &o) {
+      release();
+      steal(o);
+    }
+    return *this;
+  }
+
+  ~small_vector() { release(); }
+
+  template<class InputIterator>
+  void assign(InputIterator first, InputIterator last)
+  {
+    *this = small_vector(first, last);
+  }
+
+  iterator begin() { return is_inline() ? inline_ : heap_.data; }
+  iterator end() { return begin() + size(); }
+  const_iterator begin() const { return is_inline() ? inline_ : heap_.data; }
+  const_iterator end() const { return begin() + size(); }
+
+  T* data() { return begin(); }
+  T const* data() const { return begin(); }
+
+  size_type size() const { return is_inline() ? tag_ : heap_.size; }
+  bool empty() const { return size() == 0; }
+  static constexpr size_type max_size()
+  {
+    return std::numeric_limits<difference_type>::max() / sizeof(T);
+  }
+
+  reference operator[](size_type i) { return begin()[i]; }
+  const_reference operator[](size_type i) const { return begin()[i]; }
+
+  void clear()
+  {
+    release();
+    init(0);
+  }
+
+  iterator erase(iterator pos)
+  {
+    auto const i = pos - begin();
+    std::copy(pos + 1, end(), pos);
+    if (is_inline()) {
+      inline_[--tag_] = T();
+    } else if (heap_.size - 1 > N) {
+      -- heap_.size;
+    } else {
+      // back inline
+      small_vector shorter(begin(), end() - 1);
+      *this = std::move(shorter);
+    }
+    return begin() + i;
+  }
+
+  friend bool operator==(small_vector const& a, small_vector const& b)
+  {
+    if (a.tag_ != b.tag_)
+      return false;
+    // the unused elements are zero in both
+    if (a.is_inline())
+      return std::equal(a.inline_, a.inline_ + N, b.inline_);
+    return a.size() == b.size() and std::equal(a.begin(), a.end(), b.begin());
+  }
+
+  friend bool operator<(small_vector const& a, small_vector const& b)
+  {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+  }
+
+  friend std::size_t hash_value(small_vector const& v)
+  {
+    return boost::hash_range(v.begin(), v.end());
+  }
+};
+
+#endif
@@ -0,0 +1,15 @@
+#!/bin/sh
+# usage: profile.sh longest_path tests_dir
+#
+# counts 4x4_sq with --profile, compares the counts with 4x4_sq.output
+# and the trace, without the times and the heap sizes, with
+# 4x4_sq_profile.output
+set -e
+exe=$1
+dir=$2
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+"$exe" --input-file "$dir/4x4_sq.input" --profile "$tmp/profile.json" 2>/dev/null | diff - "$dir/4x4_sq.output"
+sed -e 's/"ts":[0-9.e+-]*,"dur":[0-9.e+-]*,//' \
+    -e 's/,"live_heap_delta":-\{0,1\}[0-9]*//' "$tmp/profile.json" | diff - "$dir/4x4_sq_profile.output"
@@ -0,0 +1,22 @@
+#!/bin/sh
+# usage: serve.sh longest_path tests_dir
+#
+# starts a server, sends it the jobs of serve.input and compares the
+# answers, without the progress lines, with serve.output
+set -e
+exe=$1
+dir=$2
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+"$exe" --serve "$tmp/socket" --threads 2 2>/dev/null &
+server=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+  [ -S "$tmp/socket" ] && break
+  sleep 0.2
+done
+
+"$exe" --connect "$tmp/socket" < "$dir/serve.input" | grep -v '"status"' > "$tmp/answers"
+echo '!shutdown' | "$exe" --connect "$tmp/socket"
+wait $server
+sort "$tmp/answers" | diff - "$dir/serve.output"